@@ -103,7 +103,20 @@ int generatePoissonRand(double k, double lambda, double x) {
 	return x;
 }
 
+/**
+ @param state set to the current state of the generators
+ */
+void getRNGState(struct RNGState *state) {
+	state->lastX = lastX;
+	state->z1 = z1;
+	state->generate = generate;
+}
 
-
-
-
+/**
+ @param state a state saved by getRNGState(), which the generators carry on from
+ */
+void setRNGState(const struct RNGState *state) {
+	lastX = state->lastX;
+	z1 = state->z1;
+	generate = state->generate;
+}
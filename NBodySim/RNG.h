@@ -12,8 +12,17 @@
 
 extern long lastX;
 
+// everything the generators remember between calls, so that a checkpoint can restore them exactly
+struct RNGState {
+	long lastX;
+	double z1; // the second number of the last Box-Muller pair
+	char generate; // whether z1 hasn't been used yet
+};
+
 double generateUniformRandInRange(double lowerBound, double upperBound);
 double generateNormalRand(double sigma);
 int generatePoissonRand(double k, double L, double x);
+void getRNGState(struct RNGState *state);
+void setRNGState(const struct RNGState *state);
 
 #endif /* RNG_h */
@@ -12,11 +12,11 @@
 #include "constants.h"
 #include "main.h"
 
-void initialize_pair_orbit_test(struct Vortex *vortices, int n);
-void initialize_pair_parallel_test(struct Vortex *vortices, int n);
-void initialize_square_system(struct Vortex *vortices, int n);
-void initialize_single_point(struct Vortex *vortices, int n);
-void initialize_test_case_4(struct Vortex *vortices, int n);
-void initialize_test(struct Vortex *vortices, int n);
+void initialize_pair_orbit_test(struct Vortices *vortices, int n);
+void initialize_pair_parallel_test(struct Vortices *vortices, int n);
+void initialize_square_system(struct Vortices *vortices, int n);
+void initialize_single_point(struct Vortices *vortices, int n);
+void initialize_test_case_4(struct Vortices *vortices, int n);
+void initialize_test(struct Vortices *vortices, int n);
 
 #endif /* TestCaseInitializers_h */
@@ -0,0 +1,35 @@
+//
+//  allocations.c
+//  NBodySim
+//
+
+#include "allocations.h"
+#include <stdlib.h>
+
+static long allocations = 0; // updated atomically, since the kernel workspaces grow on worker threads
+
+/**
+ realloc(), counted by heapAllocations()
+ */
+void *countedRealloc(void *pointer, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return realloc(pointer, size);
+}
+
+/**
+ count an allocation which didn't go through countedRealloc()
+ */
+void countAllocation(void) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ @return the number of allocations counted since the count was last reset
+ */
+long heapAllocations(void) {
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+void resetHeapAllocations(void) {
+    __atomic_store_n(&allocations, 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,25 @@
+//
+//  allocations.h
+//  NBodySim
+//
+
+#ifndef allocations_h
+#define allocations_h
+
+#include <stddef.h>
+
+/*
+ Counts the heap allocations made while the simulation runs.
+
+ Every buffer which is used during a timestep is kept between timesteps and only grows when the number of particles
+ goes past what it has room for, so a timestep in the steady state shouldn't allocate anything. The buffers grow
+ through countedRealloc() instead of realloc(), and anything allocated some other way calls countAllocation(), which
+ makes that easy to check: main prints how many allocations each timestep made. Allocations which are only made once, while the simulation is set up, aren't counted.
+ */
+
+void *countedRealloc(void *pointer, size_t size);
+void countAllocation(void);
+long heapAllocations(void);
+void resetHeapAllocations(void);
+
+#endif /* allocations_h */
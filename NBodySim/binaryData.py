@@ -0,0 +1,74 @@
+# usage:
+# python binaryData.py path/to/rawDataFile [step]
+# reads raw data saved with BINARY_RAWDATA (the format is described in fileIO.c). With just the file, prints the header and
+# the timesteps in the file. With a step, prints the vortices and tracers of that timestep.
+
+from sys import argv
+import os
+import struct
+
+headerFormat = struct.Struct('<8s8id')
+stepFormat = struct.Struct('<3i4xq')
+trailerFormat = struct.Struct('<2q8s')
+
+vortexFormat = struct.Struct('<q5di4x') # vID, xPos, yPos, xVel, yVel, Intensity, spawnStep
+tracerFormat = struct.Struct('<i4x4d') # tIndex, xPos, yPos, xVel, yVel
+indexFormat = struct.Struct('<2q') # step number, offset
+
+class BinaryData(object):
+    def __init__(self, path):
+        self.f = open(path, 'rb')
+        self.fSize = os.path.getsize(path)
+
+        (magic, self.version, self.headerSize, self.stepSize, self.vortexSize, self.tracerSize,
+            self.domainX, self.domainY, _, self.timestepConst) = headerFormat.unpack(self.f.read(headerFormat.size))
+        assert (magic == b'NBVSTRAJ'), "%s isn't a binary raw data file"%path
+        assert (self.version == 1), "unknown binary raw data version %i"%self.version
+        assert (self.vortexSize == vortexFormat.size and self.tracerSize == tracerFormat.size)
+
+        self.offsets = self.readIndex()
+
+    def readIndex(self):
+        """@return a dict of step number -> byte offset, from the index at the end of the file, or by walking the steps if the
+        simulation didn't finish and there is no index"""
+        if self.fSize >= self.headerSize + trailerFormat.size:
+            self.f.seek(self.fSize - trailerFormat.size)
+            count, indexOffset, magic = trailerFormat.unpack(self.f.read(trailerFormat.size))
+            if magic == b'NBVSINDX':
+                self.f.seek(indexOffset)
+                return dict(indexFormat.iter_unpack(self.f.read(count * indexFormat.size)))
+
+        offsets = {}
+        offset = self.headerSize
+        while offset + self.stepSize <= self.fSize:
+            self.f.seek(offset)
+            step, numV, numT, _ = stepFormat.unpack(self.f.read(self.stepSize))
+            end = offset + self.stepSize + numV * self.vortexSize + numT * self.tracerSize
+            if end > self.fSize: break
+            offsets[step] = offset
+            offset = end
+        return offsets
+
+    def readStep(self, step):
+        """@return (seed value, vortices, tracers) of a timestep, where the vortices and tracers are lists of tuples in the order
+        of their records"""
+        self.f.seek(self.offsets[step])
+        stepNum, numV, numT, seed = stepFormat.unpack(self.f.read(self.stepSize))
+        assert (stepNum == step)
+        vorts = list(vortexFormat.iter_unpack(self.f.read(numV * self.vortexSize)))
+        tracers = list(tracerFormat.iter_unpack(self.f.read(numT * self.tracerSize)))
+        return seed, vorts, tracers
+
+if __name__ == '__main__':
+    data = BinaryData(argv[1])
+    if len(argv) == 3:
+        seed, vorts, tracers = data.readStep(int(argv[2]))
+        print("step %s, seed %i, %i vortices, %i tracers"%(argv[2], seed, len(vorts), len(tracers)))
+        for vort in vorts:
+            print("%i,%.15f,%.15f,%.15f,%.15f,%.15f,%i"%vort)
+        for tracer in tracers:
+            print("%i,%.15f,%.15f,%.15f,%.15f"%tracer)
+    else:
+        steps = sorted(data.offsets)
+        print("version %i, %ix%i domain, timestep %f"%(data.version, data.domainX, data.domainY, data.timestepConst))
+        if steps: print("%i timesteps, %i to %i"%(len(steps), steps[0], steps[-1]))
@@ -0,0 +1,464 @@
+//
+//  biotSavart.c
+//  NBodySim
+//
+
+#include "biotSavart.h"
+#include "constants.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define X86_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef void (*KernelFunction)(const double *, const double *, const double *, int, double, double, double, double *, double *);
+typedef void (*SingleKernelFunction)(const float *, const float *, const float *, int, float, float, float, double *, double *);
+
+// offsets added to source - target for each image, in the same order as the old domain numbering:
+//    1 2 3
+//    4 0 5
+//    6 7 8
+static double imageX[NUM_IMAGE_DOMAINS];
+static double imageY[NUM_IMAGE_DOMAINS];
+static int numImages = 1;
+static double cutoffSquared;
+static KernelFunction kernel = NULL;
+
+// the same table for the single precision kernels
+static float imageXSingle[NUM_IMAGE_DOMAINS];
+static float imageYSingle[NUM_IMAGE_DOMAINS];
+static float cutoffSquaredSingle;
+static SingleKernelFunction singleKernel = NULL;
+
+static const double inverseTwoPi = 1. / (2. * M_PI);
+static const float inverseTwoPiSingle = (float)(1. / (2. * M_PI));
+
+#pragma mark - Kernels
+
+/**
+ plain C version, also used for the sources left over after the last full vector
+ */
+static void imageSum_scalar(const double *sourceX, const double *sourceY, const double *gamma, int count, double targetX, double targetY, double minRadSquared, double *xVel, double *yVel) {
+    double uSum = 0, vSum = 0;
+    for (int j = 0; j < count; j++) {
+        double strength = gamma[j] * inverseTwoPi;
+        for (int k = 0; k < numImages; k++) {
+            double dx = (sourceX[j] - targetX) + imageX[k];
+            double dy = (sourceY[j] - targetY) + imageY[k];
+            double radSquared = dx * dx + dy * dy;
+            if (radSquared > cutoffSquared || radSquared < minRadSquared) continue;
+
+            double factor = strength / radSquared;
+            uSum += dy * factor;
+            vSum -= dx * factor;
+        }
+    }
+    *xVel += uSum;
+    *yVel += vSum;
+}
+
+#ifdef X86_KERNELS
+
+__attribute__((target("sse2")))
+static void imageSum_sse2(const double *sourceX, const double *sourceY, const double *gamma, int count, double targetX, double targetY, double minRadSquared, double *xVel, double *yVel) {
+    __m128d uSum = _mm_setzero_pd();
+    __m128d vSum = _mm_setzero_pd();
+    const __m128d scale = _mm_set1_pd(inverseTwoPi);
+    const __m128d cutoff = _mm_set1_pd(cutoffSquared);
+    const __m128d minimum = _mm_set1_pd(minRadSquared);
+    const __m128d tx = _mm_set1_pd(targetX);
+    const __m128d ty = _mm_set1_pd(targetY);
+
+    int j = 0;
+    for (; j + 2 <= count; j += 2) {
+        __m128d x = _mm_sub_pd(_mm_loadu_pd(sourceX + j), tx);
+        __m128d y = _mm_sub_pd(_mm_loadu_pd(sourceY + j), ty);
+        __m128d strength = _mm_mul_pd(_mm_loadu_pd(gamma + j), scale);
+
+        for (int k = 0; k < numImages; k++) {
+            __m128d dx = _mm_add_pd(x, _mm_set1_pd(imageX[k]));
+            __m128d dy = _mm_add_pd(y, _mm_set1_pd(imageY[k]));
+            __m128d radSquared = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+            __m128d keep = _mm_and_pd(_mm_cmple_pd(radSquared, cutoff), _mm_cmpge_pd(radSquared, minimum));
+
+            __m128d factor = _mm_and_pd(keep, _mm_div_pd(strength, radSquared));
+            uSum = _mm_add_pd(uSum, _mm_mul_pd(dy, factor));
+            vSum = _mm_sub_pd(vSum, _mm_mul_pd(dx, factor));
+        }
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, uSum);
+    *xVel += lanes[0] + lanes[1];
+    _mm_storeu_pd(lanes, vSum);
+    *yVel += lanes[0] + lanes[1];
+
+    imageSum_scalar(sourceX + j, sourceY + j, gamma + j, count - j, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+__attribute__((target("avx2,fma")))
+static void imageSum_avx2(const double *sourceX, const double *sourceY, const double *gamma, int count, double targetX, double targetY, double minRadSquared, double *xVel, double *yVel) {
+    __m256d uSum = _mm256_setzero_pd();
+    __m256d vSum = _mm256_setzero_pd();
+    const __m256d scale = _mm256_set1_pd(inverseTwoPi);
+    const __m256d cutoff = _mm256_set1_pd(cutoffSquared);
+    const __m256d minimum = _mm256_set1_pd(minRadSquared);
+    const __m256d tx = _mm256_set1_pd(targetX);
+    const __m256d ty = _mm256_set1_pd(targetY);
+
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d x = _mm256_sub_pd(_mm256_loadu_pd(sourceX + j), tx);
+        __m256d y = _mm256_sub_pd(_mm256_loadu_pd(sourceY + j), ty);
+        __m256d strength = _mm256_mul_pd(_mm256_loadu_pd(gamma + j), scale);
+
+        for (int k = 0; k < numImages; k++) {
+            __m256d dx = _mm256_add_pd(x, _mm256_set1_pd(imageX[k]));
+            __m256d dy = _mm256_add_pd(y, _mm256_set1_pd(imageY[k]));
+            __m256d radSquared = _mm256_fmadd_pd(dx, dx, _mm256_mul_pd(dy, dy));
+            __m256d keep = _mm256_and_pd(_mm256_cmp_pd(radSquared, cutoff, _CMP_LE_OQ), _mm256_cmp_pd(radSquared, minimum, _CMP_GE_OQ));
+
+            __m256d factor = _mm256_and_pd(keep, _mm256_div_pd(strength, radSquared));
+            uSum = _mm256_fmadd_pd(dy, factor, uSum);
+            vSum = _mm256_fnmadd_pd(dx, factor, vSum);
+        }
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, uSum);
+    *xVel += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_storeu_pd(lanes, vSum);
+    *yVel += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    imageSum_scalar(sourceX + j, sourceY + j, gamma + j, count - j, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+__attribute__((target("avx512f")))
+static void imageSum_avx512(const double *sourceX, const double *sourceY, const double *gamma, int count, double targetX, double targetY, double minRadSquared, double *xVel, double *yVel) {
+    __m512d uSum = _mm512_setzero_pd();
+    __m512d vSum = _mm512_setzero_pd();
+    const __m512d scale = _mm512_set1_pd(inverseTwoPi);
+    const __m512d cutoff = _mm512_set1_pd(cutoffSquared);
+    const __m512d minimum = _mm512_set1_pd(minRadSquared);
+    const __m512d tx = _mm512_set1_pd(targetX);
+    const __m512d ty = _mm512_set1_pd(targetY);
+
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m512d x = _mm512_sub_pd(_mm512_loadu_pd(sourceX + j), tx);
+        __m512d y = _mm512_sub_pd(_mm512_loadu_pd(sourceY + j), ty);
+        __m512d strength = _mm512_mul_pd(_mm512_loadu_pd(gamma + j), scale);
+
+        for (int k = 0; k < numImages; k++) {
+            __m512d dx = _mm512_add_pd(x, _mm512_set1_pd(imageX[k]));
+            __m512d dy = _mm512_add_pd(y, _mm512_set1_pd(imageY[k]));
+            __m512d radSquared = _mm512_fmadd_pd(dx, dx, _mm512_mul_pd(dy, dy));
+            __mmask8 keep = _mm512_cmp_pd_mask(radSquared, cutoff, _CMP_LE_OQ) & _mm512_cmp_pd_mask(radSquared, minimum, _CMP_GE_OQ);
+
+            __m512d factor = _mm512_maskz_div_pd(keep, strength, radSquared);
+            uSum = _mm512_fmadd_pd(dy, factor, uSum);
+            vSum = _mm512_fnmadd_pd(dx, factor, vSum);
+        }
+    }
+
+    *xVel += _mm512_reduce_add_pd(uSum);
+    *yVel += _mm512_reduce_add_pd(vSum);
+
+    imageSum_scalar(sourceX + j, sourceY + j, gamma + j, count - j, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+#endif
+
+#pragma mark - Single Precision Kernels
+
+/*
+ The single precision kernels do twice as many sources per instruction as the double ones. Every lane keeps a Kahan compensation
+ term next to its running sum, which holds the low order bits lost by the last addition, so the error of the sum doesn't grow with
+ the number of sources. v is summed as dx * factor and subtracted at the end, so both sums use the same update. The lanes are
+ reduced in double precision.
+ */
+
+/**add term to a compensated sum*/
+static inline void kahanAdd(float *sum, float *compensation, float term) {
+    float corrected = term - *compensation;
+    float total = *sum + corrected;
+    *compensation = (total - *sum) - corrected;
+    *sum = total;
+}
+
+/**@return the total of the compensated sums in each lane*/
+static double compensatedTotal(const float *sums, const float *compensations, int lanes) {
+    double total = 0;
+    for (int i = 0; i < lanes; i++) total += (double)sums[i] - compensations[i];
+    return total;
+}
+
+/**
+ plain C version, also used for the sources left over after the last full vector
+ */
+static void imageSumSingle_scalar(const float *sourceX, const float *sourceY, const float *gamma, int count, float targetX, float targetY, float minRadSquared, double *xVel, double *yVel) {
+    float uSum = 0, vSum = 0, uCompensation = 0, vCompensation = 0;
+    for (int j = 0; j < count; j++) {
+        float strength = gamma[j] * inverseTwoPiSingle;
+        for (int k = 0; k < numImages; k++) {
+            float dx = (sourceX[j] - targetX) + imageXSingle[k];
+            float dy = (sourceY[j] - targetY) + imageYSingle[k];
+            float radSquared = dx * dx + dy * dy;
+            if (radSquared > cutoffSquaredSingle || radSquared < minRadSquared) continue;
+
+            float factor = strength / radSquared;
+            kahanAdd(&uSum, &uCompensation, dy * factor);
+            kahanAdd(&vSum, &vCompensation, dx * factor);
+        }
+    }
+    *xVel += compensatedTotal(&uSum, &uCompensation, 1);
+    *yVel -= compensatedTotal(&vSum, &vCompensation, 1);
+}
+
+#ifdef X86_KERNELS
+
+__attribute__((target("sse2")))
+static void imageSumSingle_sse2(const float *sourceX, const float *sourceY, const float *gamma, int count, float targetX, float targetY, float minRadSquared, double *xVel, double *yVel) {
+    __m128 uSum = _mm_setzero_ps(), uCompensation = _mm_setzero_ps();
+    __m128 vSum = _mm_setzero_ps(), vCompensation = _mm_setzero_ps();
+    const __m128 scale = _mm_set1_ps(inverseTwoPiSingle);
+    const __m128 cutoff = _mm_set1_ps(cutoffSquaredSingle);
+    const __m128 minimum = _mm_set1_ps(minRadSquared);
+    const __m128 tx = _mm_set1_ps(targetX);
+    const __m128 ty = _mm_set1_ps(targetY);
+
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m128 x = _mm_sub_ps(_mm_loadu_ps(sourceX + j), tx);
+        __m128 y = _mm_sub_ps(_mm_loadu_ps(sourceY + j), ty);
+        __m128 strength = _mm_mul_ps(_mm_loadu_ps(gamma + j), scale);
+
+        for (int k = 0; k < numImages; k++) {
+            __m128 dx = _mm_add_ps(x, _mm_set1_ps(imageXSingle[k]));
+            __m128 dy = _mm_add_ps(y, _mm_set1_ps(imageYSingle[k]));
+            __m128 radSquared = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            __m128 keep = _mm_and_ps(_mm_cmple_ps(radSquared, cutoff), _mm_cmpge_ps(radSquared, minimum));
+            __m128 factor = _mm_and_ps(keep, _mm_div_ps(strength, radSquared));
+
+            __m128 corrected = _mm_sub_ps(_mm_mul_ps(dy, factor), uCompensation);
+            __m128 total = _mm_add_ps(uSum, corrected);
+            uCompensation = _mm_sub_ps(_mm_sub_ps(total, uSum), corrected);
+            uSum = total;
+
+            corrected = _mm_sub_ps(_mm_mul_ps(dx, factor), vCompensation);
+            total = _mm_add_ps(vSum, corrected);
+            vCompensation = _mm_sub_ps(_mm_sub_ps(total, vSum), corrected);
+            vSum = total;
+        }
+    }
+
+    float sums[4], compensations[4];
+    _mm_storeu_ps(sums, uSum);
+    _mm_storeu_ps(compensations, uCompensation);
+    *xVel += compensatedTotal(sums, compensations, 4);
+    _mm_storeu_ps(sums, vSum);
+    _mm_storeu_ps(compensations, vCompensation);
+    *yVel -= compensatedTotal(sums, compensations, 4);
+
+    imageSumSingle_scalar(sourceX + j, sourceY + j, gamma + j, count - j, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+__attribute__((target("avx2,fma")))
+static void imageSumSingle_avx2(const float *sourceX, const float *sourceY, const float *gamma, int count, float targetX, float targetY, float minRadSquared, double *xVel, double *yVel) {
+    __m256 uSum = _mm256_setzero_ps(), uCompensation = _mm256_setzero_ps();
+    __m256 vSum = _mm256_setzero_ps(), vCompensation = _mm256_setzero_ps();
+    const __m256 scale = _mm256_set1_ps(inverseTwoPiSingle);
+    const __m256 cutoff = _mm256_set1_ps(cutoffSquaredSingle);
+    const __m256 minimum = _mm256_set1_ps(minRadSquared);
+    const __m256 tx = _mm256_set1_ps(targetX);
+    const __m256 ty = _mm256_set1_ps(targetY);
+
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m256 x = _mm256_sub_ps(_mm256_loadu_ps(sourceX + j), tx);
+        __m256 y = _mm256_sub_ps(_mm256_loadu_ps(sourceY + j), ty);
+        __m256 strength = _mm256_mul_ps(_mm256_loadu_ps(gamma + j), scale);
+
+        for (int k = 0; k < numImages; k++) {
+            __m256 dx = _mm256_add_ps(x, _mm256_set1_ps(imageXSingle[k]));
+            __m256 dy = _mm256_add_ps(y, _mm256_set1_ps(imageYSingle[k]));
+            __m256 radSquared = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+            __m256 keep = _mm256_and_ps(_mm256_cmp_ps(radSquared, cutoff, _CMP_LE_OQ), _mm256_cmp_ps(radSquared, minimum, _CMP_GE_OQ));
+            __m256 factor = _mm256_and_ps(keep, _mm256_div_ps(strength, radSquared));
+
+            __m256 corrected = _mm256_fmsub_ps(dy, factor, uCompensation);
+            __m256 total = _mm256_add_ps(uSum, corrected);
+            uCompensation = _mm256_sub_ps(_mm256_sub_ps(total, uSum), corrected);
+            uSum = total;
+
+            corrected = _mm256_fmsub_ps(dx, factor, vCompensation);
+            total = _mm256_add_ps(vSum, corrected);
+            vCompensation = _mm256_sub_ps(_mm256_sub_ps(total, vSum), corrected);
+            vSum = total;
+        }
+    }
+
+    float sums[8], compensations[8];
+    _mm256_storeu_ps(sums, uSum);
+    _mm256_storeu_ps(compensations, uCompensation);
+    *xVel += compensatedTotal(sums, compensations, 8);
+    _mm256_storeu_ps(sums, vSum);
+    _mm256_storeu_ps(compensations, vCompensation);
+    *yVel -= compensatedTotal(sums, compensations, 8);
+
+    imageSumSingle_scalar(sourceX + j, sourceY + j, gamma + j, count - j, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+__attribute__((target("avx512f")))
+static void imageSumSingle_avx512(const float *sourceX, const float *sourceY, const float *gamma, int count, float targetX, float targetY, float minRadSquared, double *xVel, double *yVel) {
+    __m512 uSum = _mm512_setzero_ps(), uCompensation = _mm512_setzero_ps();
+    __m512 vSum = _mm512_setzero_ps(), vCompensation = _mm512_setzero_ps();
+    const __m512 scale = _mm512_set1_ps(inverseTwoPiSingle);
+    const __m512 cutoff = _mm512_set1_ps(cutoffSquaredSingle);
+    const __m512 minimum = _mm512_set1_ps(minRadSquared);
+    const __m512 tx = _mm512_set1_ps(targetX);
+    const __m512 ty = _mm512_set1_ps(targetY);
+
+    int j = 0;
+    for (; j + 16 <= count; j += 16) {
+        __m512 x = _mm512_sub_ps(_mm512_loadu_ps(sourceX + j), tx);
+        __m512 y = _mm512_sub_ps(_mm512_loadu_ps(sourceY + j), ty);
+        __m512 strength = _mm512_mul_ps(_mm512_loadu_ps(gamma + j), scale);
+
+        for (int k = 0; k < numImages; k++) {
+            __m512 dx = _mm512_add_ps(x, _mm512_set1_ps(imageXSingle[k]));
+            __m512 dy = _mm512_add_ps(y, _mm512_set1_ps(imageYSingle[k]));
+            __m512 radSquared = _mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy));
+            __mmask16 keep = _mm512_cmp_ps_mask(radSquared, cutoff, _CMP_LE_OQ) & _mm512_cmp_ps_mask(radSquared, minimum, _CMP_GE_OQ);
+            __m512 factor = _mm512_maskz_div_ps(keep, strength, radSquared);
+
+            __m512 corrected = _mm512_fmsub_ps(dy, factor, uCompensation);
+            __m512 total = _mm512_add_ps(uSum, corrected);
+            uCompensation = _mm512_sub_ps(_mm512_sub_ps(total, uSum), corrected);
+            uSum = total;
+
+            corrected = _mm512_fmsub_ps(dx, factor, vCompensation);
+            total = _mm512_add_ps(vSum, corrected);
+            vCompensation = _mm512_sub_ps(_mm512_sub_ps(total, vSum), corrected);
+            vSum = total;
+        }
+    }
+
+    float sums[16], compensations[16];
+    _mm512_storeu_ps(sums, uSum);
+    _mm512_storeu_ps(compensations, uCompensation);
+    *xVel += compensatedTotal(sums, compensations, 16);
+    _mm512_storeu_ps(sums, vSum);
+    _mm512_storeu_ps(compensations, vCompensation);
+    *yVel -= compensatedTotal(sums, compensations, 16);
+
+    imageSumSingle_scalar(sourceX + j, sourceY + j, gamma + j, count - j, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+#endif
+
+#pragma mark - Dispatch
+
+/**
+ @return the highest SIMD level the CPU running the simulation supports
+ */
+static int supportedSimdLevel(void) {
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+/**
+ Build the image offset table and pick the kernel. Must be called after importConstants().
+
+ @param maxLevel the highest SIMD level to use, or -1 to use the best one the CPU supports
+ @param images the number of image domains to sum over, 1 to disable wrapping of forces or NUM_IMAGE_DOMAINS to enable it
+ */
+void initBiotSavart(int maxLevel, int images) {
+    const int offsets[NUM_IMAGE_DOMAINS][2] = {{0, 0}, {-1, 1}, {0, 1}, {1, 1}, {-1, 0}, {1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+    for (int k = 0; k < NUM_IMAGE_DOMAINS; k++) {
+        imageX[k] = offsets[k][0] * DOMAIN_SIZE_X;
+        imageY[k] = offsets[k][1] * DOMAIN_SIZE_Y;
+        imageXSingle[k] = imageX[k];
+        imageYSingle[k] = imageY[k];
+    }
+    numImages = images;
+    cutoffSquared = (double)DOMAIN_SIZE_X * DOMAIN_SIZE_X;
+    cutoffSquaredSingle = cutoffSquared;
+
+    int level = supportedSimdLevel();
+    if (maxLevel >= 0 && maxLevel < level) level = maxLevel;
+
+    const char *names[] = {"scalar", "SSE2", "AVX2", "AVX-512"};
+    switch (level) {
+#ifdef X86_KERNELS
+        case SIMD_AVX512: kernel = imageSum_avx512; singleKernel = imageSumSingle_avx512; break;
+        case SIMD_AVX2: kernel = imageSum_avx2; singleKernel = imageSumSingle_avx2; break;
+        case SIMD_SSE2: kernel = imageSum_sse2; singleKernel = imageSumSingle_sse2; break;
+#endif
+        default: kernel = imageSum_scalar; singleKernel = imageSumSingle_scalar; level = SIMD_SCALAR; break;
+    }
+    printf("Using %s velocity kernels\n", names[level]);
+}
+
+/**
+ Add the velocity induced at a target by a list of sources and their images to xVel and yVel. The sources can either be given
+ as positions, or as separations from the target with targetX = targetY = 0.
+
+ @param sourceX x-position of each source
+ @param sourceY y-position of each source
+ @param gamma the intensity of each source
+ @param count the number of sources
+ @param targetX x-position of the target
+ @param targetY y-position of the target
+ @param minRadSquared images closer than sqrt(minRadSquared) are skipped. 0 to include everything
+ */
+void biotSavartVelocity(const double *sourceX, const double *sourceY, const double *gamma, int count, double targetX, double targetY, double minRadSquared, double *xVel, double *yVel) {
+    kernel(sourceX, sourceY, gamma, count, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+/**
+ biotSavartVelocity() in single precision, with compensated sums. The velocity is still added to doubles.
+ */
+void biotSavartVelocitySingle(const float *sourceX, const float *sourceY, const float *gamma, int count, float targetX, float targetY, float minRadSquared, double *xVel, double *yVel) {
+    singleKernel(sourceX, sourceY, gamma, count, targetX, targetY, minRadSquared, xVel, yVel);
+}
+
+/**
+ A scratch buffer for packing kernel inputs, owned by the calling thread. It is reused by the next call from the same thread.
+
+ @param count the number of sources the buffer needs to hold
+ @return room for 3 * count doubles: xRad at [0], yRad at [count] and gamma at [2 * count]
+ */
+double *biotSavartWorkspace(int count) {
+    static _Thread_local double *workspace = NULL;
+    static _Thread_local int workspaceLength = 0;
+
+    if (count > workspaceLength) {
+        workspaceLength = count + count/2 + 16;
+        workspace = countedRealloc(workspace, sizeof(double) * 3 * workspaceLength);
+        if (workspace == NULL) {
+            printf("Error allocating kernel workspace");
+            exit(1);
+        }
+    }
+    return workspace;
+}
+
+/**
+ biotSavartWorkspace() for packing the inputs of biotSavartVelocitySingle(). It is the same buffer.
+
+ @param count the number of sources the buffer needs to hold
+ @return room for 3 * count floats: xRad at [0], yRad at [count] and gamma at [2 * count]
+ */
+float *biotSavartSingleWorkspace(int count) {
+    return (float *)biotSavartWorkspace(count);
+}
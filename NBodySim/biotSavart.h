@@ -0,0 +1,42 @@
+//
+//  biotSavart.h
+//  NBodySim
+//
+
+#ifndef biotSavart_h
+#define biotSavart_h
+
+#define NUM_IMAGE_DOMAINS 9 // the driver domain and its 8 neighbors
+
+/*
+ Vectorized point vortex interaction kernels for the direct solver.
+
+ Each call sums the velocity induced at one target by a list of sources, over the driver domain and its 8
+ neighboring images, dropping any image further away than DOMAIN_SIZE_X:
+
+    u += gamma * yRad / (2*pi*r^2),   v -= gamma * xRad / (2*pi*r^2)
+
+ where (xRad, yRad) = source - target + image offset. The image offsets come from a table which is built once
+ from the domain size, so the loops are branch free, and there is no sqrt.
+
+ There is a version of the kernel for plain C, SSE2, AVX2 + FMA and AVX-512. The best one the CPU supports is
+ picked at startup with cpuid, so the same binary runs at full speed on older and newer machines. SIMD_LEVEL in the
+ config file can force a lower level.
+
+ Every kernel also has a single precision version for TRACER_SINGLE_PRECISION, which takes floats and does twice as
+ many sources per instruction. It keeps its sums with Kahan compensation, so that the rounding error stays at the
+ level of one float operation however many sources there are.
+ */
+
+#define SIMD_SCALAR 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3
+
+void initBiotSavart(int maxLevel, int numImages);
+void biotSavartVelocity(const double *sourceX, const double *sourceY, const double *gamma, int count, double targetX, double targetY, double minRadSquared, double *xVel, double *yVel);
+double *biotSavartWorkspace(int count);
+void biotSavartVelocitySingle(const float *sourceX, const float *sourceY, const float *gamma, int count, float targetX, float targetY, float minRadSquared, double *xVel, double *yVel);
+float *biotSavartSingleWorkspace(int count);
+
+#endif /* biotSavart_h */
@@ -0,0 +1,100 @@
+//
+//  cellList.c
+//  NBodySim
+//
+
+#include "cellList.h"
+#include "constants.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ @return the cell of the list which a position is in. Positions outside of the driver domain are wrapped into it
+ */
+int cellListCell(const struct CellList *cells, double x, double y) {
+    int cellX = (int)floor(x / DOMAIN_SIZE_X * cells->cellsX) % cells->cellsX;
+    int cellY = (int)floor(y / DOMAIN_SIZE_Y * cells->cellsY) % cells->cellsY;
+    if (cellX < 0) cellX += cells->cellsX;
+    if (cellY < 0) cellY += cells->cellsY;
+    return cellY * cells->cellsX + cellX;
+}
+
+/**
+ Sort a set of points into cells. Memory from a previous build is reused.
+
+ @param cells the cell list to (re)build
+ @param x array of x-positions
+ @param y array of y-positions
+ @param count the length of the x and y arrays
+ @param minCellSize the smallest width and height of a cell. Cells are as small as possible while still being at least this big
+ */
+void buildCellList(struct CellList *cells, const double *x, const double *y, int count, double minCellSize) {
+    cells->cellsX = (int)(DOMAIN_SIZE_X / minCellSize);
+    cells->cellsY = (int)(DOMAIN_SIZE_Y / minCellSize);
+    if (cells->cellsX < 1) cells->cellsX = 1;
+    if (cells->cellsY < 1) cells->cellsY = 1;
+
+    int numCells = cells->cellsX * cells->cellsY;
+    if (numCells > cells->cellsAllocated) {
+        cells->cellsAllocated = numCells;
+        cells->cellStart = countedRealloc(cells->cellStart, sizeof(int) * (numCells + 1));
+    }
+    if (count > cells->pointsAllocated) {
+        cells->pointsAllocated = count * 1.5;
+        cells->entries = countedRealloc(cells->entries, sizeof(int) * cells->pointsAllocated);
+        cells->cellOf = countedRealloc(cells->cellOf, sizeof(int) * cells->pointsAllocated);
+    }
+    if (cells->cellStart == NULL || (count && (cells->entries == NULL || cells->cellOf == NULL))) {
+        printf("Error reallocating cell list");
+        exit(1);
+    }
+
+    memset(cells->cellStart, 0, sizeof(int) * (numCells + 1));
+    for (int i = 0; i < count; i++) {
+        cells->cellOf[i] = cellListCell(cells, x[i], y[i]);
+        cells->cellStart[cells->cellOf[i] + 1]++;
+    }
+    for (int cell = 0; cell < numCells; cell++) cells->cellStart[cell + 1] += cells->cellStart[cell];
+
+    // fill each cell from the back, using the start of the next cell as the cursor, so that no extra array is needed
+    for (int i = count - 1; i >= 0; i--) {
+        cells->entries[--cells->cellStart[cells->cellOf[i] + 1]] = i;
+    }
+    // every cursor has moved back to the start of its own cell, which shifted cellStart up by one place
+    memmove(&cells->cellStart[0], &cells->cellStart[1], sizeof(int) * numCells);
+    cells->cellStart[numCells] = count;
+}
+
+void freeCellList(struct CellList *cells) {
+    free(cells->cellStart);
+    free(cells->entries);
+    free(cells->cellOf);
+    memset(cells, 0, sizeof(struct CellList));
+}
+
+/**
+ find a cell and the cells around it, wrapping across the edges of the domain. With fewer than 3 cells on a side the neighboring
+ cells would repeat, so every cell on that side is listed once
+
+ @param neighbors filled with the neighboring cells, including the cell itself
+ @return the number of cells in neighbors
+ */
+int cellListNeighbors(const struct CellList *cells, int cell, int neighbors[9]) {
+    int cellX = cell % cells->cellsX;
+    int cellY = cell / cells->cellsX;
+    int firstX = (cells->cellsX >= 3) ? cellX - 1 : 0, lastX = (cells->cellsX >= 3) ? cellX + 1 : cells->cellsX - 1;
+    int firstY = (cells->cellsY >= 3) ? cellY - 1 : 0, lastY = (cells->cellsY >= 3) ? cellY + 1 : cells->cellsY - 1;
+
+    int count = 0;
+    for (int neighborY = firstY; neighborY <= lastY; neighborY++) {
+        for (int neighborX = firstX; neighborX <= lastX; neighborX++) {
+            int wrappedX = (neighborX + cells->cellsX) % cells->cellsX;
+            int wrappedY = (neighborY + cells->cellsY) % cells->cellsY;
+            neighbors[count++] = wrappedY * cells->cellsX + wrappedX;
+        }
+    }
+    return count;
+}
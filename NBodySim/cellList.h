@@ -0,0 +1,33 @@
+//
+//  cellList.h
+//  NBodySim
+//
+
+#ifndef cellList_h
+#define cellList_h
+
+/*
+ A uniform grid over the periodic driver domain, for finding every point within a short distance of another.
+
+ The domain is split into cells at least minCellSize wide, and the points are counting sorted into them, so
+ building the list is O(N). Every point within minCellSize of a position is in the position's cell or one of
+ the 8 around it, wrapping across the edges of the domain. Points are kept in increasing index order within
+ each cell.
+ */
+struct CellList {
+    int cellsX;
+    int cellsY;
+    int cellsAllocated;
+    int *cellStart; // points in cell c are entries[cellStart[c]] to entries[cellStart[c+1] - 1]
+
+    int pointsAllocated;
+    int *entries; // point indices, sorted by cell
+    int *cellOf; // the cell of each point
+};
+
+void buildCellList(struct CellList *cells, const double *x, const double *y, int count, double minCellSize);
+void freeCellList(struct CellList *cells);
+int cellListCell(const struct CellList *cells, double x, double y);
+int cellListNeighbors(const struct CellList *cells, int cell, int neighbors[9]);
+
+#endif /* cellList_h */
@@ -37,7 +37,7 @@ fi
 
 if [ -z "${debug+x}" ]; then debug="false"; fi
 
-command="gcc ./constants.c ./main.c ./guiOutput.c ./TestCaseInitializers.c ./fileIO.c ./RNG.c ./C-Thread-Pool/thpool.c -o ./data/simulator $args"
+command="gcc ./constants.c ./main.c ./guiOutput.c ./TestCaseInitializers.c ./fileIO.c ./RNG.c ./quadtree.c ./lattice.c ./fmm.c ./periodicKernel.c ./fft.c ./particleMesh.c ./biotSavart.c ./team.c ./cellList.c ./allocations.c ./numberFormat.c -o ./data/simulator $args"
 echo "Full compilation instruction is: $command"
 eval "$command"
 
@@ -13,9 +13,15 @@ int TEST_CASE = 0;
 char DRAW_CONSOLE = 0;
 char DRAW_PNG = 0;
 char SAVE_RAWDATA = 0;
-char DATA_OUT_FILEPATH[255] = "";
+char SAVE_RK_STEPS = 0;
+char BINARY_RAWDATA = 0;
+int OUTPUT_BUFFERS = 2;
+char SHORTEST_DIGITS = 0;
+char DATA_OUT_FILEPATH[255] = "./data/rawData";
 char INITFNAME[255] = "";
 int INIT_TIME_STEP = 0;
+char CHECKPOINT_FILEPATH[255] = "./data/checkpoint";
+int CHECKPOINT_INTERVAL = 0;
 int CONSOLE_W = 200;
 int CONSOLE_H = 100;
 int IMAGE_W = 1000;
@@ -33,12 +39,24 @@ int NUMBER_OF_STEPS = 1000;
 #endif
 int NUM_TRACERS = 1;
 int NUM_VORT_INIT = 64;
+int VORTEX_CAPACITY = 0;
 int FIRST_SEED = -1;
 char VORTEX_LIFECYCLE = 1;
 float VORTEX_INTENSITY_SIGMA = 0.21233045007200477 * 2 * M_PI;
 float VORTEX_SPAWN_RATE = 2.56;
 int VORTEX_MERGE_RADIUS = 1;
 int THREADCOUNT = 8;
+int MORTON_SORT_INTERVAL = 0;
+int VELOCITY_SOLVER = SOLVER_DIRECT;
+float TREE_THETA = .5;
+int PM_GRID_SIZE = 256;
+char P3M_CORRECTION = 1;
+char PERIODIC_KERNEL = 0;
+char RADII_FREE = 0;
+char TRACER_SINGLE_PRECISION = 0;
+int TRACER_PRECISION_REPORT = 0;
+int SIMD_LEVEL = -1;
+char VALIDATE_RADII = 0;
 
 void importConstants(char *filename) {
     if (filename == NULL) {
@@ -80,12 +98,24 @@ void importConstants(char *filename) {
             DRAW_PNG = 1;
         } else if (strcmp(keyword, "SAVE_RAWDATA") == 0) {
             SAVE_RAWDATA = 1;
+        } else if (strcmp(keyword, "SAVE_RK_STEPS") == 0) {
+            SAVE_RK_STEPS = 1;
+        } else if (strcmp(keyword, "BINARY_RAWDATA") == 0) {
+            BINARY_RAWDATA = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "OUTPUT_BUFFERS") == 0) {
+            OUTPUT_BUFFERS = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "SHORTEST_DIGITS") == 0) {
+            SHORTEST_DIGITS = strtol(value, NULL, 10);
         } else if (strcmp(keyword, "DATA_OUT_FILEPATH") == 0) {
             memcpy(DATA_OUT_FILEPATH, value, strlen(value)+1);
         } else if (strcmp(keyword, "INITFNAME") == 0) {
             memcpy(INITFNAME, value, strlen(value)+1);
         } else if (strcmp(keyword, "INIT_TIME_STEP") == 0) {
             INIT_TIME_STEP = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "CHECKPOINT_FILEPATH") == 0) {
+            memcpy(CHECKPOINT_FILEPATH, value, strlen(value)+1);
+        } else if (strcmp(keyword, "CHECKPOINT_INTERVAL") == 0) {
+            CHECKPOINT_INTERVAL = strtol(value, NULL, 10);
         } else if (strcmp(keyword, "CONSOLE_H") == 0) {
             CONSOLE_H = strtol(value, NULL, 10);
         } else if (strcmp(keyword, "CONSOLE_W") == 0) {
@@ -112,6 +142,8 @@ void importConstants(char *filename) {
             NUM_TRACERS = strtol(value, NULL, 10);
         } else if (strcmp(keyword, "NUM_VORT_INIT") == 0) {
             NUM_VORT_INIT = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "VORTEX_CAPACITY") == 0) {
+            VORTEX_CAPACITY = strtol(value, NULL, 10);
         } else if (strcmp(keyword, "FIRST_SEED") == 0) {
             FIRST_SEED = strtol(value, NULL, 10);
         } else if (strcmp(keyword, "VORTEX_LIFECYCLE") == 0) {
@@ -124,6 +156,28 @@ void importConstants(char *filename) {
             VORTEX_MERGE_RADIUS = strtof(value, NULL);
         } else if (strcmp(keyword, "THREADCOUNT") == 0) {
             THREADCOUNT = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "VELOCITY_SOLVER") == 0) {
+            VELOCITY_SOLVER = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "TREE_THETA") == 0) {
+            TREE_THETA = strtof(value, NULL);
+        } else if (strcmp(keyword, "PM_GRID_SIZE") == 0) {
+            PM_GRID_SIZE = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "P3M_CORRECTION") == 0) {
+            P3M_CORRECTION = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "PERIODIC_KERNEL") == 0) {
+            PERIODIC_KERNEL = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "MORTON_SORT_INTERVAL") == 0) {
+            MORTON_SORT_INTERVAL = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "RADII_FREE") == 0) {
+            RADII_FREE = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "TRACER_SINGLE_PRECISION") == 0) {
+            TRACER_SINGLE_PRECISION = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "TRACER_PRECISION_REPORT") == 0) {
+            TRACER_PRECISION_REPORT = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "SIMD_LEVEL") == 0) {
+            SIMD_LEVEL = strtol(value, NULL, 10);
+        } else if (strcmp(keyword, "VALIDATE_RADII") == 0) {
+            VALIDATE_RADII = strtol(value, NULL, 10);
         } else {
             fprintf(stderr, "error: could not parse config file line:\n%s\n", buff);
         }
@@ -33,12 +33,18 @@ extern char DRAW_CONSOLE;
 extern char DRAW_PNG;
 extern char SAVE_RAWDATA;
 extern char SAVE_RK_STEPS; // save each runge-kutta timestep, in addition to every normal timestep
+extern char BINARY_RAWDATA; // 1 saves the raw data in the binary format described in fileIO.c, with an index of the timesteps, instead of text
+extern char SHORTEST_DIGITS; // text raw data: 1 writes each number with the fewest decimals which read back as the same double, instead of 15
+extern int OUTPUT_BUFFERS; // timesteps which can be queued for the output writer thread before the simulation waits for it. 0 to write each timestep before the next one starts
 
 // file names for the file to initialize the simulation from, and the filepath to
-// write to. To disable initilzing from a source file, set INITFNAME to "".
+// write to. To disable initilzing from a source file, set INITFNAME to "". INITFNAME can be
+// a text or binary raw data file, or a checkpoint.
 extern char DATA_OUT_FILEPATH[255];
 extern char INITFNAME[255];
 extern int INIT_TIME_STEP;
+extern char CHECKPOINT_FILEPATH[255]; // where checkpoints are written. INITFNAME can be set to one to carry on from it
+extern int CHECKPOINT_INTERVAL; // write a checkpoint every this many timesteps. 0 to only write one on SIGUSR1 and when the simulation is stopped with SIGTERM or SIGINT
 
 extern int CONSOLE_W; // character dimensions to draw to console
 extern int CONSOLE_H;
@@ -59,6 +65,7 @@ extern int NUMBER_OF_STEPS; // number of time steps to simulate. 0 to loop forev
 
 extern int NUM_TRACERS; // NOTE: must be a square number
 extern int NUM_VORT_INIT;
+extern int VORTEX_CAPACITY; // number of vortices to make room for up front. Should be at least the steady state population. 0 to base it on NUM_VORT_INIT
 extern int FIRST_SEED; // seed the sim. -1 to use current unix time stamp
 
 extern char VORTEX_LIFECYCLE; // controls whether vortices are merged/spawned
@@ -69,6 +76,32 @@ extern int VORTEX_MERGE_RADIUS;
 extern int nextVortID;
 
 extern int THREADCOUNT;
+extern int MORTON_SORT_INTERVAL; // reorder the vortices and tracers along a Z-order curve every this many timesteps, so that particles which are close in space are close in memory. 0 to never reorder
+
+/*
+ Velocity solver numbering info:
+
+ num:	solver
+ 0:		direct summation over the radii arrays (reference)
+ 1:		Barnes-Hut tree code, accuracy set by TREE_THETA
+ 2:		fast multipole method with the exact periodic kernel (no truncation radius)
+ 3:		particle-mesh FFT solver, with the P3M short range correction if P3M_CORRECTION is set
+ */
+#define SOLVER_DIRECT 0
+#define SOLVER_TREE 1
+#define SOLVER_FMM 2
+#define SOLVER_PM 3
+
+extern int VELOCITY_SOLVER;
+extern float TREE_THETA; // opening angle for the tree code. Smaller is more accurate and slower
+extern int PM_GRID_SIZE; // grid points per side for the particle-mesh solver. Must be a power of 2
+extern char P3M_CORRECTION; // add the short range direct sum to the particle-mesh velocities
+extern char PERIODIC_KERNEL; // direct solver: 0 sums the 8 neighboring images with truncation, 1 uses the exact tabulated periodic kernel
+extern char RADII_FREE; // direct solver: 1 integrates from per-particle stage positions instead of the O(N^2) radii arrays. The other solvers always do
+extern char TRACER_SINGLE_PRECISION; // direct solver without PERIODIC_KERNEL: 1 sums the tracer velocities in single precision, with compensated sums. Vortices stay in double
+extern int TRACER_PRECISION_REPORT; // with TRACER_SINGLE_PRECISION, compare the tracer velocities against double precision every this many timesteps. 0 to never compare
+extern int SIMD_LEVEL; // highest instruction set for the direct solver kernels: 0 scalar, 1 SSE2, 2 AVX2, 3 AVX-512. -1 picks the best the CPU supports
+extern char VALIDATE_RADII; // debugging: 1 checks the radii arrays against a full recalculation after vortices are merged and deleted
 
 void importConstants(char *);
 #endif
@@ -0,0 +1,99 @@
+//
+//  fft.c
+//  NBodySim
+//
+
+#include "fft.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ in-place iterative radix-2 FFT of n points spaced stride apart
+
+ @param twiddles e^(-2*pi*i*k/n) for k < n/2, conjugated for the inverse transform
+ */
+static void fft1D(double complex *data, int n, int stride, const double complex *twiddles) {
+    // bit reversal permutation
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+
+        if (i < j) {
+            double complex temp = data[i * stride];
+            data[i * stride] = data[j * stride];
+            data[j * stride] = temp;
+        }
+    }
+
+    for (int length = 2; length <= n; length <<= 1) {
+        int half = length >> 1;
+        int twiddleStep = n / length;
+        for (int start = 0; start < n; start += length) {
+            for (int k = 0; k < half; k++) {
+                double complex even = data[(start + k) * stride];
+                double complex odd = data[(start + k + half) * stride] * twiddles[k * twiddleStep];
+                data[(start + k) * stride] = even + odd;
+                data[(start + k + half) * stride] = even - odd;
+            }
+        }
+    }
+}
+
+// scratch space, kept between transforms so that they don't allocate anything. Only one transform runs at a time
+static double complex *twiddlesX = NULL;
+static double complex *twiddlesY = NULL;
+static double complex *column = NULL;
+static int scratchLength = 0;
+
+static void computeTwiddles(double complex *twiddles, int n, char inverse) {
+    for (int k = 0; k < n / 2; k++) {
+        double angle = 2 * M_PI * k / n;
+        twiddles[k] = cos(angle) + (inverse ? 1 : -1) * sin(angle) * I;
+    }
+}
+
+/**
+ Two dimensional FFT. The inverse transform is normalized, so a forward then inverse transform returns the original data.
+
+ @param data sizeX * sizeY values stored row by row, transformed in place
+ @param sizeX number of values per row. Must be a power of 2
+ @param sizeY number of rows. Must be a power of 2
+ @param inverse true for the inverse transform
+ */
+void fft2D(double complex *data, int sizeX, int sizeY, char inverse) {
+    if (sizeX < 1 || sizeY < 1 || (sizeX & (sizeX - 1)) || (sizeY & (sizeY - 1))) {
+        printf("Error: FFT size %ix%i is not a power of 2\n", sizeX, sizeY);
+        exit(1);
+    }
+
+    int length = (sizeX > sizeY) ? sizeX : sizeY;
+    if (length > scratchLength) {
+        scratchLength = length;
+        twiddlesX = countedRealloc(twiddlesX, sizeof(double complex) * (length / 2 + 1));
+        twiddlesY = countedRealloc(twiddlesY, sizeof(double complex) * (length / 2 + 1));
+        column = countedRealloc(column, sizeof(double complex) * length);
+        if (twiddlesX == NULL || twiddlesY == NULL || column == NULL) {
+            printf("Error allocating FFT scratch space");
+            exit(1);
+        }
+    }
+    computeTwiddles(twiddlesX, sizeX, inverse);
+    computeTwiddles(twiddlesY, sizeY, inverse);
+
+    for (int row = 0; row < sizeY; row++) fft1D(&data[row * sizeX], sizeX, 1, twiddlesX);
+
+    // columns are copied out so that the transform runs over contiguous memory
+    for (int col = 0; col < sizeX; col++) {
+        for (int row = 0; row < sizeY; row++) column[row] = data[row * sizeX + col];
+        fft1D(column, sizeY, 1, twiddlesY);
+        for (int row = 0; row < sizeY; row++) data[row * sizeX + col] = column[row];
+    }
+
+    if (inverse) {
+        double scale = 1. / ((double)sizeX * sizeY);
+        for (long i = 0; i < (long)sizeX * sizeY; i++) data[i] *= scale;
+    }
+}
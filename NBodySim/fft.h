@@ -0,0 +1,13 @@
+//
+//  fft.h
+//  NBodySim
+//
+
+#ifndef fft_h
+#define fft_h
+
+#include <complex.h>
+
+void fft2D(double complex *data, int sizeX, int sizeY, char inverse);
+
+#endif /* fft_h */
@@ -4,13 +4,19 @@
 //
 
 #include "fileIO.h"
+#include "allocations.h"
+#include "numberFormat.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
-
-#ifndef DATA_OUT_FILEPATH
-#define DATA_OUT_FILEPATH "./data/rawData"
-#endif
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /*
  NOTE:
@@ -77,46 +83,358 @@
  .
  .
  .
+
+
+ Binary File Format (BINARY_RAWDATA):
+
+ Every number is little-endian, whatever the machine writing the file. Integers are two's complement and floating point
+ numbers are IEEE 754 doubles. Every record has a fixed size, so a step can be read without parsing the ones before it.
+
+ Header, BINARY_HEADER_SIZE bytes:
+	char[8]  magic "NBVSTRAJ"
+	int32    format version (BINARY_VERSION)
+	int32    header size in bytes
+	int32    step header size in bytes
+	int32    vortex record size in bytes
+	int32    tracer record size in bytes
+	int32    DOMAIN_SIZE_X
+	int32    DOMAIN_SIZE_Y
+	int32    reserved, 0
+	double   TIMESTEP_CONST
+
+ Each timestep, starting with a step header of BINARY_STEP_SIZE bytes:
+	int32    step number
+	int32    number of vortices
+	int32    number of tracers
+	int32    reserved, 0
+	int64    seed value
+ followed by a record of BINARY_VORTEX_SIZE bytes for every vortex:
+	int64    vID
+	double   xPos, yPos, xVel, yVel, Intensity
+	int32    spawnStep
+	int32    reserved, 0
+ and a record of BINARY_TRACER_SIZE bytes for every tracer:
+	int32    tIndex
+	int32    reserved, 0
+	double   xPos, yPos, xVel, yVel
+
+ When the file is closed, an index of every timestep in the file is written after the last one, followed by a trailer
+ at the very end of the file:
+	{int64 step number, int64 byte offset of the step header} for every timestep, in the order they were written
+	int64    number of index entries
+	int64    byte offset of the index
+	char[8]  magic "NBVSINDX"
+
+ A reader can find any timestep by reading the trailer and then the index. If the simulation didn't finish, there is
+ no index, but the steps can still be walked from the header, since each step header gives the size of the step.
+
+
+ Checkpoint Format:
+
+ A checkpoint holds everything the simulation needs to carry on exactly as if it had never stopped. It's encoded the same
+ way as the binary format, with a header of CHECKPOINT_HEADER_SIZE bytes:
+	char[8]  magic "NBVSCHKP"
+	int32    format version (CHECKPOINT_VERSION)
+	int32    the next timestep to run
+	int32    number of vortices
+	int32    number of vortices the vortex arrays have room for
+	int32    number of tracers
+	int32    vortsSpawned
+	int64    nextVortID
+	int64    RNG lastX
+	double   RNG z1
+	int32    RNG generate
+	int32    reserved, 0
+	double   timestep
+	double   carryoverSpawnCount
+ followed by a vortex record and a tracer record for every particle, in the order they are stored in, since the order
+ that velocities are summed in changes their rounding.
+
+ A run resumed from a checkpoint carries on the raw data file at DATA_OUT_FILEPATH, if there is one, rather than starting it
+ over. The file is cut off after the last timestep before the checkpoint, and a binary file's index is rebuilt from its step
+ headers, so the file ends up the same as if the run had never stopped.
  */
 
+#define BINARY_VERSION 1
+#define BINARY_HEADER_SIZE 48
+#define BINARY_STEP_SIZE 24
+#define BINARY_VORTEX_SIZE 56
+#define BINARY_TRACER_SIZE 40
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_HEADER_SIZE 80
+#define OUTPUT_WRITE_SIZE (1 << 20) // bytes the raw data file is buffered in, so the disk sees few large writes
+#define TEXT_BUFFER_SIZE (1 << 16) // bytes of text lines saveState() formats before writing them
+#define TEXT_LINE_MAX (7 * (FORMATTED_NUMBER_MAX + 1)) // longest vortex or tracer line
+
 FILE *file;
+static char *fileBuffer = NULL;
+
+// binary format state: the encoded timestep, and the offset of every timestep written so far, for the index
+static unsigned char *binaryBuffer = NULL;
+static long binaryBufferLength = 0;
+static long *stepIndex = NULL; // pairs of step number, offset
+static long stepIndexCount = 0;
+static long stepIndexAllocated = 0;
+static char resumedFromCheckpoint = 0; // the raw data file is carried on rather than started over
+
+// text format state: the lines of the timestep which haven't been written yet
+static char textBuffer[TEXT_BUFFER_SIZE];
+
+// a copy of the particles at the end of a timestep, waiting to be written
+struct OutputSlot {
+	int timestep;
+	long currentSeed;
+	int numVorts;
+	int numTracers;
+	struct Vortices vortices;
+	struct Tracers tracers;
+};
+
+// the output writer thread, which writes the timesteps queued in a ring of OUTPUT_BUFFERS slots while the next ones are simulated
+static struct OutputSlot *outputSlots = NULL; // NULL when the output is written synchronously
+static int outputHead = 0; // the slot the writer is on
+static int outputQueued = 0; // slots waiting to be written, starting at outputHead
+static char outputClosing = 0;
+static pthread_t outputThread;
+static pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t outputReady = PTHREAD_COND_INITIALIZER; // a slot was queued, or the file is being closed
+static pthread_cond_t outputFree = PTHREAD_COND_INITIALIZER; // a slot was written
+
+#pragma mark - Little-Endian Encoding
+
+static unsigned char *putInt32(unsigned char *out, int32_t value) {
+	uint32_t bits = (uint32_t)value;
+	for (int i = 0; i < 4; i++) out[i] = (unsigned char)(bits >> (8 * i));
+	return out + 4;
+}
+
+static unsigned char *putInt64(unsigned char *out, int64_t value) {
+	uint64_t bits = (uint64_t)value;
+	for (int i = 0; i < 8; i++) out[i] = (unsigned char)(bits >> (8 * i));
+	return out + 8;
+}
+
+static unsigned char *putDouble(unsigned char *out, double value) {
+	int64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return putInt64(out, bits);
+}
+
+static int32_t getInt32(const unsigned char *in) {
+	uint32_t bits = 0;
+	for (int i = 0; i < 4; i++) bits |= (uint32_t)in[i] << (8 * i);
+	return (int32_t)bits;
+}
+
+static int64_t getInt64(const unsigned char *in) {
+	uint64_t bits = 0;
+	for (int i = 0; i < 8; i++) bits |= (uint64_t)in[i] << (8 * i);
+	return (int64_t)bits;
+}
+
+static double getDouble(const unsigned char *in) {
+	int64_t bits = getInt64(in);
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/**
+ encode the vortex and tracer records of the binary format
+
+ @return the end of the records
+ */
+static unsigned char *putParticles(unsigned char *out, int numVorts, struct Vortices *vorts, int numTracers, struct Tracers *tracers) {
+	for (int i = 0; i < numVorts; i++) {
+		out = putInt64(out, vorts->id[i]);
+		out = putDouble(out, vorts->x[i]);
+		out = putDouble(out, vorts->y[i]);
+		out = putDouble(out, vorts->u[i]);
+		out = putDouble(out, vorts->v[i]);
+		out = putDouble(out, vorts->gamma[i]);
+		out = putInt32(out, vorts->initStep[i]);
+		out = putInt32(out, 0);
+	}
+
+	for (int i = 0; i < numTracers; i++) {
+		out = putInt32(out, tracers->id[i]);
+		out = putInt32(out, 0);
+		out = putDouble(out, tracers->x[i]);
+		out = putDouble(out, tracers->y[i]);
+		out = putDouble(out, tracers->u[i]);
+		out = putDouble(out, tracers->v[i]);
+	}
+	return out;
+}
+
+/**
+ decode vortex and tracer records written by putParticles() into particle arrays which have room for them
+ */
+static void getParticles(const unsigned char *in, int numVorts, struct Vortices *vortices, int numTracers, struct Tracers *tracers) {
+	for (int i = 0; i < numVorts; i++, in += BINARY_VORTEX_SIZE) {
+		vortices->id[i] = getInt64(in);
+		vortices->x[i] = getDouble(in + 8);
+		vortices->y[i] = getDouble(in + 16);
+		vortices->u[i] = getDouble(in + 24);
+		vortices->v[i] = getDouble(in + 32);
+		vortices->gamma[i] = getDouble(in + 40);
+		vortices->initStep[i] = getInt32(in + 48);
+	}
+	for (int i = 0; i < numTracers; i++, in += BINARY_TRACER_SIZE) {
+		tracers->id[i] = getInt32(in);
+		tracers->x[i] = getDouble(in + 8);
+		tracers->y[i] = getDouble(in + 16);
+		tracers->u[i] = getDouble(in + 24);
+		tracers->v[i] = getDouble(in + 32);
+	}
+}
+
+/**
+ make sure the binary buffer can hold a number of bytes. It grows by half again, so that writing the same size of timestep
+ doesn't allocate
+ */
+static void reserveBinaryBuffer(long length) {
+	if (length <= binaryBufferLength) return;
+	binaryBufferLength = length + length/2;
+	binaryBuffer = countedRealloc(binaryBuffer, binaryBufferLength);
+	if (binaryBuffer == NULL) {
+		printf("Error allocating binary output buffer");
+		exit(1);
+	}
+}
+
+/**
+ add a timestep to the index written by closeFile()
+ */
+static void addStepIndex(int timestep, long offset) {
+	if (stepIndexCount == stepIndexAllocated) {
+		stepIndexAllocated = (stepIndexAllocated > 0) ? stepIndexAllocated * 2 : 1024;
+		stepIndex = countedRealloc(stepIndex, sizeof(long) * 2 * stepIndexAllocated);
+		if (stepIndex == NULL) {
+			printf("Error allocating binary step index");
+			exit(1);
+		}
+	}
+	stepIndex[stepIndexCount * 2] = timestep;
+	stepIndex[stepIndexCount * 2 + 1] = offset;
+	stepIndexCount++;
+}
+
+#pragma mark - Writing
 
+static void *outputWriter(void *unused);
+static char prepareResume(void);
+
+/**
+ open DATA_OUT_FILEPATH, and start the output writer thread unless OUTPUT_BUFFERS is 0. After a checkpoint is loaded, an existing file
+ is carried on from the checkpoint instead of being started over
+ */
 void openFile() {
+	char resuming = prepareResume();
 	// file = fopen("./data/rawData", "a");
-	file = fopen(DATA_OUT_FILEPATH, "w");
+	file = fopen(DATA_OUT_FILEPATH, resuming ? "r+b" : "wb");
 	assert(file);
+	fileBuffer = countedRealloc(NULL, OUTPUT_WRITE_SIZE);
+	if (fileBuffer == NULL || setvbuf(file, fileBuffer, _IOFBF, OUTPUT_WRITE_SIZE) != 0) {
+		printf("Error buffering the raw data file");
+		exit(1);
+	}
+
+	if (resuming) {
+		fseek(file, 0, SEEK_END);
+	} else if (BINARY_RAWDATA) {
+		unsigned char header[BINARY_HEADER_SIZE];
+		unsigned char *out = header;
+		memcpy(out, "NBVSTRAJ", 8);
+		out += 8;
+		out = putInt32(out, BINARY_VERSION);
+		out = putInt32(out, BINARY_HEADER_SIZE);
+		out = putInt32(out, BINARY_STEP_SIZE);
+		out = putInt32(out, BINARY_VORTEX_SIZE);
+		out = putInt32(out, BINARY_TRACER_SIZE);
+		out = putInt32(out, DOMAIN_SIZE_X);
+		out = putInt32(out, DOMAIN_SIZE_Y);
+		out = putInt32(out, 0);
+		out = putDouble(out, TIMESTEP_CONST);
+		assert(out - header == BINARY_HEADER_SIZE);
+		assert(fwrite(header, 1, BINARY_HEADER_SIZE, file) == BINARY_HEADER_SIZE);
+	}
+
+	if (OUTPUT_BUFFERS > 0) {
+		outputSlots = countedRealloc(NULL, sizeof(struct OutputSlot) * OUTPUT_BUFFERS);
+		if (outputSlots == NULL) {
+			printf("Error allocating output buffers");
+			exit(1);
+		}
+		memset(outputSlots, 0, sizeof(struct OutputSlot) * OUTPUT_BUFFERS);
+		for (int i = 0; i < OUTPUT_BUFFERS; i++) allocateTracers(&outputSlots[i].tracers, NUM_TRACERS);
+		outputHead = outputQueued = outputClosing = 0;
+
+		if (pthread_create(&outputThread, NULL, outputWriter, NULL) != 0) {
+			printf("Error starting the output writer thread");
+			exit(1);
+		}
+	}
 }
 
-void saveState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortex *vorts, struct Tracer *tracers) {
-	assert(fprintf(file, "\x1D%i,%li,%i,%i\n", timestep, currentSeed, numVorts, numTracers) >= 0);
-	fputc(0x1E, file);
+static char *putNumber(char *out, double value) {
+	return SHORTEST_DIGITS ? putShortest(out, value) : putFixed(out, value);
+}
+
+/**
+ write out the text buffer
+
+ @param end the end of the text in the buffer
+ @return the start of the buffer, to carry on writing lines from
+ */
+static char *writeText(char *end) {
+	assert(fwrite(textBuffer, 1, end - textBuffer, file) == (size_t)(end - textBuffer));
+	return textBuffer;
+}
+
+/**
+ save a timestep in the text format. The lines are formatted into textBuffer by numberFormat.c rather than printf, which gives the
+ same text, and written out whenever it's nearly full
+ */
+void saveState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers) {
+	char *out = textBuffer;
+	out += sprintf(out, "\x1D%i,%li,%i,%i\n", timestep, currentSeed, numVorts, numTracers);
+	*out++ = 0x1E;
 	for (int i = 0; i < numVorts; i++) {
-		struct Vortex *vort = &vorts[i];
-		assert(fprintf(file,
-				"%li,%.15f,%.15f,%.15f,%.15f,%.15f,%i\n",
-				vort->vID,
-				vort->position[0],
-				vort->position[1],
-				vort->velocity[0],
-				vort->velocity[1],
-				vort->intensity,
-				vort->initStep) >= 0);
-	}
-	fputc(0x1E, file);
+		if (textBuffer + TEXT_BUFFER_SIZE - out < TEXT_LINE_MAX) out = writeText(out);
+		out = putInteger(out, vorts->id[i]);
+		*out++ = ',';
+		out = putNumber(out, vorts->x[i]);
+		*out++ = ',';
+		out = putNumber(out, vorts->y[i]);
+		*out++ = ',';
+		out = putNumber(out, vorts->u[i]);
+		*out++ = ',';
+		out = putNumber(out, vorts->v[i]);
+		*out++ = ',';
+		out = putNumber(out, vorts->gamma[i]);
+		*out++ = ',';
+		out = putInteger(out, vorts->initStep[i]);
+		*out++ = '\n';
+	}
+	*out++ = 0x1E;
 	
 	for (int i = 0; i < numTracers; i++) {
-		struct Tracer *tracer = &tracers[i];
-		assert(fprintf(file,
-				"%i,%.15f,%.15f,%.15f,%.15f\n",
-				tracer->tIndex,
-				tracer->position[0],
-				tracer->position[1],
-				tracer->velocity[0],
-				tracer->velocity[1]) >= 0);
+		if (textBuffer + TEXT_BUFFER_SIZE - out < TEXT_LINE_MAX) out = writeText(out);
+		out = putInteger(out, tracers->id[i]);
+		*out++ = ',';
+		out = putNumber(out, tracers->x[i]);
+		*out++ = ',';
+		out = putNumber(out, tracers->y[i]);
+		*out++ = ',';
+		out = putNumber(out, tracers->u[i]);
+		*out++ = ',';
+		out = putNumber(out, tracers->v[i]);
+		*out++ = '\n';
 	}
 	
 	// fputc(29, file);
-	fflush(file);
+	writeText(out);
 }
 
 void saveIntermediateVortPositions(int numVorts, struct RKPositions *positions) {
@@ -127,59 +445,228 @@ void saveIntermediateVortPositions(int numVorts, struct RKPositions *positions)
             double x, y;
             switch(RKStep) {
                 case 1:
-                    x = positions->step1Pos.x;
-                    y = positions->step1Pos.y;
+                    x = positions[i].step1Pos.x;
+                    y = positions[i].step1Pos.y;
                     break;
                 case 2:
-                    x = positions->step2Pos.x;
-                    y = positions->step2Pos.y;
+                    x = positions[i].step2Pos.x;
+                    y = positions[i].step2Pos.y;
                     break;
                 case 3:
-                    x = positions->step3Pos.x;
-                    y = positions->step3Pos.y;
+                    x = positions[i].step3Pos.x;
+                    y = positions[i].step3Pos.y;
                     break;
                 case 4:
-                    x = positions->step4Pos.x;
-                    y = positions->step4Pos.y;
+                    x = positions[i].step4Pos.x;
+                    y = positions[i].step4Pos.y;
                     break;
             }
-            fprintf(file, "%ld: [%lf, %lf],", positions->vort->vID, x, y);
+            fprintf(file, "%ld: [%lf, %lf],", positions[i].vID, x, y);
         }
         fprintf(file, "}");
     }
     fprintf(file, "]");
 }
 
-void saveState_binary(int timestep, double currentTime, unsigned int currentSeed, int numVorts, int numTracers, struct Vortex *vorts, struct Tracer *tracers) {
-	assert(fprintf(file, "\x1D%i,%f,%u,%i,%i\n", timestep, currentTime, currentSeed, numVorts, numTracers) >= 0);
+/**
+ saveState() in the binary format. The timestep is encoded into a buffer and written with one call, and its offset is kept for the
+ index written by closeFile()
+ */
+void saveState_binary(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers) {
+	long length = BINARY_STEP_SIZE + (long)numVorts * BINARY_VORTEX_SIZE + (long)numTracers * BINARY_TRACER_SIZE;
+	reserveBinaryBuffer(length);
+
+	unsigned char *out = binaryBuffer;
+	out = putInt32(out, timestep);
+	out = putInt32(out, numVorts);
+	out = putInt32(out, numTracers);
+	out = putInt32(out, 0);
+	out = putInt64(out, currentSeed);
+	out = putParticles(out, numVorts, vorts, numTracers, tracers);
+	assert(out - binaryBuffer == length);
+
+	addStepIndex(timestep, ftell(file));
+
+	assert(fwrite(binaryBuffer, 1, length, file) == (size_t)length);
+}
+
+static void writeState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers) {
+	if (BINARY_RAWDATA) {
+		saveState_binary(timestep, currentSeed, numVorts, numTracers, vorts, tracers);
+	} else {
+		saveState(timestep, currentSeed, numVorts, numTracers, vorts, tracers);
+	}
+}
+
+/**
+ write the queued timesteps in order until closeFile(). The file is only flushed when its buffer fills, so the disk sees writes of
+ OUTPUT_WRITE_SIZE bytes
+ */
+static void *outputWriter(void *unused) {
+	pthread_mutex_lock(&outputLock);
+	while (1) {
+		while (outputQueued == 0 && !outputClosing) pthread_cond_wait(&outputReady, &outputLock);
+		if (outputQueued == 0) break;
+		struct OutputSlot *slot = &outputSlots[outputHead];
+		pthread_mutex_unlock(&outputLock);
+
+		writeState(slot->timestep, slot->currentSeed, slot->numVorts, slot->numTracers, &slot->vortices, &slot->tracers);
+
+		pthread_mutex_lock(&outputLock);
+		outputHead = (outputHead + 1) % OUTPUT_BUFFERS;
+		outputQueued--;
+		pthread_cond_signal(&outputFree);
+	}
+	pthread_mutex_unlock(&outputLock);
+	return NULL;
+}
+
+/**
+ save a timestep in the raw data format chosen by BINARY_RAWDATA. With OUTPUT_BUFFERS, the particles are copied into a free slot for the
+ writer thread to write while the next timestep runs. If every slot is still waiting to be written, this waits for the writer
+
+ @return seconds spent waiting for a free slot
+ */
+double outputState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers) {
+	if (outputSlots == NULL) {
+		writeState(timestep, currentSeed, numVorts, numTracers, vorts, tracers);
+		fflush(file);
+		return 0;
+	}
+
+	double waited = 0;
+	pthread_mutex_lock(&outputLock);
+	if (outputQueued == OUTPUT_BUFFERS) {
+		struct timespec waitStart, waitEnd;
+		clock_gettime(CLOCK_MONOTONIC, &waitStart);
+		while (outputQueued == OUTPUT_BUFFERS) pthread_cond_wait(&outputFree, &outputLock);
+		clock_gettime(CLOCK_MONOTONIC, &waitEnd);
+		waited = (waitEnd.tv_sec - waitStart.tv_sec) + (double)(waitEnd.tv_nsec - waitStart.tv_nsec) / 1E9;
+	}
+	// the writer doesn't touch slots past the queued ones, so this one can be filled without holding the lock
+	struct OutputSlot *slot = &outputSlots[(outputHead + outputQueued) % OUTPUT_BUFFERS];
+	pthread_mutex_unlock(&outputLock);
+
+	slot->timestep = timestep;
+	slot->currentSeed = currentSeed;
+	slot->numVorts = numVorts;
+	slot->numTracers = numTracers;
+	if (numVorts > slot->vortices.allocated) {
+		// the old contents are stale, so they aren't copied
+		freeVortices(&slot->vortices);
+		resizeVortices(&slot->vortices, numVorts + numVorts/2);
+	}
+	if (numVorts > 0) {
+		memcpy(slot->vortices.id, vorts->id, sizeof(long) * numVorts);
+		memcpy(slot->vortices.x, vorts->x, sizeof(double) * numVorts);
+		memcpy(slot->vortices.y, vorts->y, sizeof(double) * numVorts);
+		memcpy(slot->vortices.u, vorts->u, sizeof(double) * numVorts);
+		memcpy(slot->vortices.v, vorts->v, sizeof(double) * numVorts);
+		memcpy(slot->vortices.gamma, vorts->gamma, sizeof(double) * numVorts);
+		memcpy(slot->vortices.initStep, vorts->initStep, sizeof(int) * numVorts);
+	}
+	if (numTracers > 0) {
+		memcpy(slot->tracers.id, tracers->id, sizeof(int) * numTracers);
+		memcpy(slot->tracers.x, tracers->x, sizeof(double) * numTracers);
+		memcpy(slot->tracers.y, tracers->y, sizeof(double) * numTracers);
+		memcpy(slot->tracers.u, tracers->u, sizeof(double) * numTracers);
+		memcpy(slot->tracers.v, tracers->v, sizeof(double) * numTracers);
+	}
+
+	pthread_mutex_lock(&outputLock);
+	outputQueued++;
+	pthread_cond_signal(&outputReady);
+	pthread_mutex_unlock(&outputLock);
+	return waited;
+}
+
+/**
+ write the index and trailer of a binary file, see the format description at the top of the file
+ */
+static void writeStepIndex(void) {
+	long indexOffset = ftell(file);
+	reserveBinaryBuffer(stepIndexCount * 16 + 24);
+
+	unsigned char *out = binaryBuffer;
+	for (long i = 0; i < stepIndexCount; i++) {
+		out = putInt64(out, stepIndex[i * 2]);
+		out = putInt64(out, stepIndex[i * 2 + 1]);
+	}
+	out = putInt64(out, stepIndexCount);
+	out = putInt64(out, indexOffset);
+	memcpy(out, "NBVSINDX", 8);
+	out += 8;
+	assert(fwrite(binaryBuffer, 1, out - binaryBuffer, file) == (size_t)(out - binaryBuffer));
+}
+
+/**
+ wait for the writer to write every queued timestep, and flush the file, so that it holds every timestep saved so far. Called before a
+ checkpoint is taken, so that a run resumed from it always finds the timestep before it in the file
+ */
+void flushOutput(void) {
+	if (outputSlots != NULL) {
+		pthread_mutex_lock(&outputLock);
+		while (outputQueued > 0) pthread_cond_wait(&outputFree, &outputLock);
+		pthread_mutex_unlock(&outputLock);
+	}
+	fflush(file);
 }
 
+/**
+ write every queued timestep, then the index of a binary file, and close it
+ */
 void closeFile() {
 	fprintf(stderr, "closing file\n");
+	if (outputSlots != NULL) {
+		pthread_mutex_lock(&outputLock);
+		outputClosing = 1;
+		pthread_cond_signal(&outputReady);
+		pthread_mutex_unlock(&outputLock);
+		pthread_join(outputThread, NULL);
+
+		for (int i = 0; i < OUTPUT_BUFFERS; i++) {
+			freeVortices(&outputSlots[i].vortices);
+			freeTracers(&outputSlots[i].tracers);
+		}
+		free(outputSlots);
+		outputSlots = NULL;
+	}
+
+	if (BINARY_RAWDATA) writeStepIndex();
 	fclose(file);
+	free(fileBuffer);
+	fileBuffer = NULL;
+
+	free(binaryBuffer);
+	free(stepIndex);
+	binaryBuffer = NULL;
+	stepIndex = NULL;
+	binaryBufferLength = stepIndexCount = stepIndexAllocated = 0;
 }
 
+#pragma mark - Reading
+
 /**
  binary search for the beginning of the target timestep
  */
 long findTimeStep(FILE *f, int target, long lowPos, long highPos) {
 	printf("searching in %li-%li\n", lowPos, highPos);
-	char strbuff[100];
+	char strbuff[100] = {0};
 	long domainWidth = highPos - lowPos;
+	if (domainWidth <= 0) {
+		printf("Error: timestep %i isn't in the file", target);
+		exit(1);
+	}
 	fseek(f, lowPos + domainWidth/2, SEEK_SET);
 	
-	while (strbuff[0] != 0x1D) {
-		*strbuff = (char)fgetc(f);
+	int nextChar;
+	while ((nextChar = fgetc(f)) != 0x1D) {
 		// if our entire domain is *inside* of the last timestep (and doesn't include that timestep's record sep.) then
-		// we will run out of file b4 we find the TS header. If this happens, then we should seek back in the file by the
-		// width of our search domain, then search from there. This searches the other half of the parent's domain.
-		if (*strbuff == -1) {
-			if (!fseek(f, lowPos - highPos, SEEK_CUR)) {
-				exit(EXIT_FAILURE); // seek failed.
-			}
+		// we will run out of file b4 we find the TS header. If this happens, then the target is in the lower half of the domain.
+		if (nextChar == EOF) {
+			return findTimeStep(f, target, lowPos, lowPos + domainWidth/2);
 		}
 	}
-	*strbuff = 0;
 	long tsStartLoc = ftell(f);
 	
 	for (int i = 0; 1; i++) {
@@ -194,12 +681,13 @@ long findTimeStep(FILE *f, int target, long lowPos, long highPos) {
 	int tsNum = atoi(strbuff);
 //	printf("center search val: %s\n", strbuff);
 
+	// the halves are rounded up, so that the domain always shrinks
 	if (tsNum == target) {
 		return tsStartLoc;
 	} else if (tsNum > target) {
-		return findTimeStep(f, target, lowPos, highPos - domainWidth/2);
+		return findTimeStep(f, target, lowPos, highPos - (domainWidth + 1)/2);
 	} else {
-		return findTimeStep(f, target, lowPos + domainWidth/2, highPos);
+		return findTimeStep(f, target, lowPos + (domainWidth + 1)/2, highPos);
 	}
 }
 
@@ -216,7 +704,10 @@ strbuff[i] = nextChar;\
 break;\
 }\
 }
-void initFromFile(char *fName, int loadIndex, struct Vortex *vortices[], int *numDriverVorts, int *vortsAllocated, struct Tracer *tracers[]) {
+/**
+ initFromFile() for a text file
+ */
+static void initFromTextFile(char *fName, int loadIndex, struct Vortices *vortices, int *numDriverVorts, struct Tracers *tracers) {
 	FILE *sourceF = fopen(fName, "r");
 	char strbuff[100]; // if a number in the file exceeds 100 characters in length, this will overflow
 	clearStrBuff;
@@ -229,12 +720,7 @@ void initFromFile(char *fName, int loadIndex, struct Vortex *vortices[], int *nu
 	
 	readNextCSV;
 	assert(loadIndex == atoi(strbuff)); // check that we are at the correct timestep in the file
-	currentTimestep = loadIndex;
-	
-	// handle (or don't handle) time
-//	clearStrBuff;
-	readNextCSV;
-//	*time = atof(strbuff);
+	currentTimestep = loadIndex + 1; // the file has the particles from the end of the timestep, so carry on from the next one
 	
 	clearStrBuff;
 	readNextCSV;
@@ -252,64 +738,399 @@ void initFromFile(char *fName, int loadIndex, struct Vortex *vortices[], int *nu
 	strbuff[0] = fgetc(sourceF);
 	assert(strbuff[0] == 0x1E);
 	
-	*vortsAllocated = (*numDriverVorts) * 1.5;
-	*vortices = malloc((int)sizeof(struct Vortex) * (*vortsAllocated));
-	*tracers = malloc((int)sizeof(struct Vortex) * NUM_TRACERS * 1.5);
+	resizeVortices(vortices, (*numDriverVorts) * 1.5 + 1);
+	allocateTracers(tracers, NUM_TRACERS);
 	
 	for (int vIndex = 0; vIndex < *numDriverVorts; vIndex++) {
-		struct Vortex *vort = &(*vortices)[vIndex];
-		vort->position = malloc(sizeof(double) * 2);
-		vort->velocity = malloc(sizeof(double) * 2);
 		clearStrBuff;
 		readNextCSV;
-		vort->vID = atoi(strbuff);
-        vort->vIndex = vIndex;
+		vortices->id[vIndex] = atoi(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		vort->position[0] = atof(strbuff);
+		vortices->x[vIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		vort->position[1] = atof(strbuff);
+		vortices->y[vIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		vort->velocity[0] = atof(strbuff);
+		vortices->u[vIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		vort->velocity[1] = atof(strbuff);
+		vortices->v[vIndex] = atof(strbuff);
 //		readNextCSV; // skip over totVel
 		clearStrBuff;
 		readNextCSV;
-		vort->intensity = atof(strbuff);
+		vortices->gamma[vIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		vort->initStep = atoi(strbuff);
+		vortices->initStep[vIndex] = atoi(strbuff);
 	}
 	
 	assert(fgetc(sourceF) == 0x1E); // make sure we are past the vortices
 	
 	for (int tIndex = 0; tIndex < NUM_TRACERS; tIndex++) {
-		struct Tracer *tracer = &(*tracers)[tIndex];
-		tracer->position = malloc(sizeof(double) * 2);
-		tracer->velocity = malloc(sizeof(double) * 2);
 		clearStrBuff;
 		readNextCSV;
-		tracer->tIndex = atoi(strbuff);
+		tracers->id[tIndex] = atoi(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		tracer->position[0] = atof(strbuff);
+		tracers->x[tIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		tracer->position[1] = atof(strbuff);
+		tracers->y[tIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		tracer->velocity[0] = atof(strbuff);
+		tracers->u[tIndex] = atof(strbuff);
 		clearStrBuff;
 		readNextCSV;
-		tracer->velocity[1] = atof(strbuff);
+		tracers->v[tIndex] = atof(strbuff);
 //		readNextCSV; // skip totVel
 	}
 	
-	assert(fgetc(sourceF) == 0x1D); // make sure that's the last of the tracers for that timestep.
+	int nextChar = fgetc(sourceF);
+	assert(nextChar == 0x1D || nextChar == EOF); // make sure that's the last of the tracers for that timestep.
 	fclose(sourceF);
 	printf("file read finished\n");
 }
+
+/**
+ map a whole file to read from. Pages are only read from disk when they are touched
+
+ @param length set to the length of the file
+ @return the mapping, to be released with munmap()
+ */
+static const unsigned char *mapFile(char *fName, long *length) {
+	int fd = open(fName, O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		printf("Error opening %s", fName);
+		exit(1);
+	}
+	*length = info.st_size;
+	const unsigned char *data = mmap(NULL, *length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		printf("Error mapping %s", fName);
+		exit(1);
+	}
+	return data;
+}
+
+/**
+ find a timestep in a mapped binary file. Files which were closed have an index of every step, which is looked up directly, since
+ the steps are usually consecutive, or else binary searched, since they are in order. Without an index, the step headers are walked.
+
+ @param data the mapped file
+ @param length the length of the file in bytes
+ @param target the step number to find
+ @return the offset of the target's step header, or -1 if it isn't in the file
+ */
+static long findBinaryStep(const unsigned char *data, long length, int target) {
+	const long trailerSize = 24;
+	if (length >= BINARY_HEADER_SIZE + trailerSize && memcmp(data + length - 8, "NBVSINDX", 8) == 0) {
+		long count = getInt64(data + length - trailerSize);
+		long indexOffset = getInt64(data + length - trailerSize + 8);
+		if (count >= 0 && indexOffset >= BINARY_HEADER_SIZE && indexOffset + count * 16 <= length - trailerSize) {
+			const unsigned char *index = data + indexOffset;
+			if (count == 0) return -1;
+
+			long guess = target - getInt64(index);
+			if (guess >= 0 && guess < count && getInt64(index + guess * 16) == target) return getInt64(index + guess * 16 + 8);
+
+			long low = 0, high = count;
+			while (low < high) {
+				long mid = (low + high) / 2;
+				long step = getInt64(index + mid * 16);
+				if (step == target) return getInt64(index + mid * 16 + 8);
+				if (step < target) {
+					low = mid + 1;
+				} else {
+					high = mid;
+				}
+			}
+			return -1;
+		}
+	}
+
+	long offset = BINARY_HEADER_SIZE;
+	while (offset + BINARY_STEP_SIZE <= length) {
+		if (getInt32(data + offset) == target) return offset;
+		offset += BINARY_STEP_SIZE + getInt32(data + offset + 4) * (long)BINARY_VORTEX_SIZE + getInt32(data + offset + 8) * (long)BINARY_TRACER_SIZE;
+	}
+	return -1;
+}
+
+/**
+ initFromFile() for a binary file. The file is mapped rather than read, so only the pages holding the index and the timestep being loaded
+ are touched, and the time it takes doesn't depend on how long the run which wrote it was. The records are decoded straight from the
+ mapping into the particle arrays.
+ */
+static void initFromBinaryFile(char *fName, int loadIndex, struct Vortices *vortices, int *numDriverVorts, struct Tracers *tracers) {
+	long length;
+	const unsigned char *data = mapFile(fName, &length);
+
+	if (length < BINARY_HEADER_SIZE || getInt32(data + 8) != BINARY_VERSION || getInt32(data + 12) != BINARY_HEADER_SIZE
+			|| getInt32(data + 16) != BINARY_STEP_SIZE || getInt32(data + 20) != BINARY_VORTEX_SIZE || getInt32(data + 24) != BINARY_TRACER_SIZE) {
+		printf("Error: %s was written by an incompatible version of the simulator", fName);
+		exit(1);
+	}
+
+	long offset = findBinaryStep(data, length, loadIndex);
+	if (offset < 0) {
+		printf("Error: timestep %i isn't in %s", loadIndex, fName);
+		exit(1);
+	}
+
+	const unsigned char *step = data + offset;
+	int numVorts = getInt32(step + 4);
+	int numTracers = getInt32(step + 8);
+	long stepLength = BINARY_STEP_SIZE + (long)numVorts * BINARY_VORTEX_SIZE + (long)numTracers * BINARY_TRACER_SIZE;
+	if (numTracers != NUM_TRACERS) {
+		printf("Error: %s has %i tracers, but NUM_TRACERS is %i", fName, numTracers, NUM_TRACERS);
+		exit(1);
+	} else if (offset + stepLength > length) {
+		printf("Error: timestep %i of %s is cut off", loadIndex, fName);
+		exit(1);
+	}
+
+	// read the whole step ahead, rather than faulting in one page at a time
+	long pageSize = sysconf(_SC_PAGESIZE);
+	long pageStart = offset - offset % pageSize;
+	madvise((void *)(data + pageStart), offset + stepLength - pageStart, MADV_WILLNEED);
+
+	// the file has the particles from the end of the timestep, so the simulation carries on from the next one
+	currentTimestep = loadIndex + 1;
+	lastX = getInt64(step + 16);
+	*numDriverVorts = numVorts;
+	resizeVortices(vortices, numVorts * 1.5 + 1);
+	allocateTracers(tracers, NUM_TRACERS);
+	getParticles(step + BINARY_STEP_SIZE, numVorts, vortices, numTracers, tracers);
+
+	munmap((void *)data, length);
+	printf("file read finished\n");
+}
+
+#pragma mark - Checkpoints
+
+/**
+ write a checkpoint of the whole simulation, see the format description at the top of the file. It's written to a temporary file which
+ is then renamed over the old checkpoint, so there is always a complete checkpoint on disk, even if the simulation is killed partway
+ through writing one.
+
+ @param fName the checkpoint file
+ @param numVorts the number of vortices
+ @param numTracers the number of tracers
+ */
+void saveCheckpoint(char *fName, int numVorts, struct Vortices *vorts, int numTracers, struct Tracers *tracers) {
+	long length = CHECKPOINT_HEADER_SIZE + (long)numVorts * BINARY_VORTEX_SIZE + (long)numTracers * BINARY_TRACER_SIZE;
+	unsigned char *buffer = countedRealloc(NULL, length);
+	if (buffer == NULL) {
+		printf("Error allocating checkpoint buffer");
+		exit(1);
+	}
+
+	struct RNGState rng;
+	getRNGState(&rng);
+
+	unsigned char *out = buffer;
+	memcpy(out, "NBVSCHKP", 8);
+	out += 8;
+	out = putInt32(out, CHECKPOINT_VERSION);
+	out = putInt32(out, currentTimestep);
+	out = putInt32(out, numVorts);
+	out = putInt32(out, vorts->allocated);
+	out = putInt32(out, numTracers);
+	out = putInt32(out, vortsSpawned);
+	out = putInt64(out, nextVortID);
+	out = putInt64(out, rng.lastX);
+	out = putDouble(out, rng.z1);
+	out = putInt32(out, rng.generate);
+	out = putInt32(out, 0);
+	out = putDouble(out, timestep);
+	out = putDouble(out, carryoverSpawnCount);
+	assert(out - buffer == CHECKPOINT_HEADER_SIZE);
+	out = putParticles(out, numVorts, vorts, numTracers, tracers);
+	assert(out - buffer == length);
+
+	char tempName[strlen(fName) + sizeof(".tmp")];
+	snprintf(tempName, sizeof(tempName), "%s.tmp", fName);
+	FILE *checkpoint = fopen(tempName, "wb");
+	if (checkpoint == NULL || fwrite(buffer, 1, length, checkpoint) != (size_t)length || fflush(checkpoint) != 0
+			|| fsync(fileno(checkpoint)) != 0 || fclose(checkpoint) != 0 || rename(tempName, fName) != 0) {
+		printf("Error writing checkpoint %s", fName);
+		exit(1);
+	}
+	free(buffer);
+	printf("Saved checkpoint before step %i to %s\n", currentTimestep, fName);
+}
+
+/**
+ initFromFile() for a checkpoint. The simulation carries on from the step after the checkpoint was taken, with all of the state it had
+ */
+static void initFromCheckpoint(char *fName, struct Vortices *vortices, int *numDriverVorts, struct Tracers *tracers) {
+	long length;
+	const unsigned char *data = mapFile(fName, &length);
+	if (length < CHECKPOINT_HEADER_SIZE || getInt32(data + 8) != CHECKPOINT_VERSION) {
+		printf("Error: %s was written by an incompatible version of the simulator", fName);
+		exit(1);
+	}
+
+	int numVorts = getInt32(data + 16);
+	int allocated = getInt32(data + 20);
+	int numTracers = getInt32(data + 24);
+	if (numTracers != NUM_TRACERS) {
+		printf("Error: %s has %i tracers, but NUM_TRACERS is %i", fName, numTracers, NUM_TRACERS);
+		exit(1);
+	} else if (length != CHECKPOINT_HEADER_SIZE + (long)numVorts * BINARY_VORTEX_SIZE + (long)numTracers * BINARY_TRACER_SIZE) {
+		printf("Error: %s is cut off", fName);
+		exit(1);
+	}
+
+	struct RNGState rng;
+	rng.lastX = getInt64(data + 40);
+	rng.z1 = getDouble(data + 48);
+	rng.generate = getInt32(data + 56);
+	setRNGState(&rng);
+
+	currentTimestep = getInt32(data + 12);
+	vortsSpawned = getInt32(data + 28);
+	nextVortID = getInt64(data + 32);
+	timestep = getDouble(data + 64);
+	carryoverSpawnCount = getDouble(data + 72);
+
+	*numDriverVorts = numVorts;
+	resizeVortices(vortices, allocated);
+	allocateTracers(tracers, NUM_TRACERS);
+	getParticles(data + CHECKPOINT_HEADER_SIZE, numVorts, vortices, numTracers, tracers);
+
+	munmap((void *)data, length);
+	resumedFromCheckpoint = 1;
+	printf("Loaded checkpoint before step %i\n", currentTimestep);
+}
+
+/**
+ skip past a record separator and the lines after it
+
+ @return the start of the next line, or NULL if the file is cut off first
+ */
+static const unsigned char *skipRecord(const unsigned char *position, const unsigned char *end, int lines) {
+	if (position == NULL || position >= end || *position != 0x1E) return NULL;
+	position++;
+	for (int i = 0; i < lines; i++) {
+		position = memchr(position, '\n', end - position);
+		if (position == NULL) return NULL;
+		position++;
+	}
+	return position;
+}
+
+/**
+ find the end of a timestep in a mapped text file. The file is searched backwards from its end, since a resumed run usually stopped
+ soon after its checkpoint
+
+ @return the offset just past the target's last tracer line, or -1 if it isn't in the file or is cut off
+ */
+static long findTextStepEnd(const unsigned char *data, long length, int target) {
+	const unsigned char *end = data + length;
+	for (const unsigned char *groupSeparator = end - 1; groupSeparator >= data; groupSeparator--) {
+		if (*groupSeparator != 0x1D) continue;
+
+		char header[100] = {0};
+		memcpy(header, groupSeparator + 1, (end - groupSeparator - 1 < (long)sizeof(header) - 1) ? end - groupSeparator - 1 : sizeof(header) - 1);
+		int step, numVorts, numTracers;
+		long seed;
+		if (sscanf(header, "%i,%li,%i,%i", &step, &seed, &numVorts, &numTracers) != 4) return -1;
+		if (step > target) continue;
+		if (step < target) return -1;
+
+		const unsigned char *position = memchr(groupSeparator, '\n', end - groupSeparator);
+		if (position == NULL) return -1;
+		position = skipRecord(position + 1, end, numVorts);
+		position = skipRecord(position, end, numTracers);
+		return (position == NULL) ? -1 : position - data;
+	}
+	return -1;
+}
+
+/**
+ get an existing raw data file ready to be carried on from a checkpoint, by cutting it off after the last timestep before the checkpoint.
+ A binary file's index and trailer are cut off with anything after that timestep, and its index is rebuilt from the step headers
+ which are left, to be written again by closeFile()
+
+ @return whether DATA_OUT_FILEPATH should be carried on, rather than started over
+ */
+static char prepareResume(void) {
+	struct stat info;
+	if (!resumedFromCheckpoint || stat(DATA_OUT_FILEPATH, &info) != 0 || info.st_size == 0) return 0;
+
+	long length;
+	const unsigned char *data = mapFile(DATA_OUT_FILEPATH, &length);
+	char binary = length >= 8 && memcmp(data, "NBVSTRAJ", 8) == 0;
+	if (binary != (BINARY_RAWDATA != 0)) {
+		printf("Error: %s isn't in the format set by BINARY_RAWDATA, so it can't be carried on. Set DATA_OUT_FILEPATH somewhere new", DATA_OUT_FILEPATH);
+		exit(1);
+	}
+
+	int lastStep = currentTimestep - 1;
+	long end;
+	if (binary) {
+		if (length < BINARY_HEADER_SIZE || getInt32(data + 8) != BINARY_VERSION || getInt32(data + 12) != BINARY_HEADER_SIZE
+				|| getInt32(data + 16) != BINARY_STEP_SIZE || getInt32(data + 20) != BINARY_VORTEX_SIZE || getInt32(data + 24) != BINARY_TRACER_SIZE) {
+			printf("Error: %s was written by an incompatible version of the simulator. Set DATA_OUT_FILEPATH somewhere new", DATA_OUT_FILEPATH);
+			exit(1);
+		}
+		end = -1;
+		long offset = findBinaryStep(data, length, lastStep);
+		if (offset >= 0 && offset + BINARY_STEP_SIZE <= length) {
+			end = offset + BINARY_STEP_SIZE + getInt32(data + offset + 4) * (long)BINARY_VORTEX_SIZE + getInt32(data + offset + 8) * (long)BINARY_TRACER_SIZE;
+			if (end > length) end = -1;
+		}
+		long step = BINARY_HEADER_SIZE;
+		while (step < end) {
+			addStepIndex(getInt32(data + step), step);
+			step += BINARY_STEP_SIZE + getInt32(data + step + 4) * (long)BINARY_VORTEX_SIZE + getInt32(data + step + 8) * (long)BINARY_TRACER_SIZE;
+		}
+	} else {
+		end = findTextStepEnd(data, length, lastStep);
+	}
+	munmap((void *)data, length);
+
+	if (end < 0) {
+		printf("Error: timestep %i isn't in %s, so it can't be carried on. Set DATA_OUT_FILEPATH somewhere new", lastStep, DATA_OUT_FILEPATH);
+		exit(1);
+	} else if (truncate(DATA_OUT_FILEPATH, end) != 0) {
+		printf("Error cutting off %s after timestep %i", DATA_OUT_FILEPATH, lastStep);
+		exit(1);
+	}
+	printf("Carrying on %s from timestep %i\n", DATA_OUT_FILEPATH, currentTimestep);
+	return 1;
+}
+
+#pragma mark - Loading
+
+/**
+ load the simulation from a timestep of a raw data file, in either the text or the binary format, or from a checkpoint. The format is
+ told apart by the magic number at the start of binary files and checkpoints. The simulation carries on from the step after the one
+ which is loaded.
+
+ @param fName the file to load from
+ @param loadIndex the step number to load. Ignored for checkpoints, which only hold one
+ */
+void initFromFile(char *fName, int loadIndex, struct Vortices *vortices, int *numDriverVorts, struct Tracers *tracers) {
+	FILE *sourceF = fopen(fName, "rb");
+	if (sourceF == NULL) {
+		printf("Error opening %s", fName);
+		exit(1);
+	}
+	char magic[8] = {0};
+	size_t magicLength = fread(magic, 1, sizeof(magic), sourceF);
+	fclose(sourceF);
+
+	if (magicLength == sizeof(magic) && memcmp(magic, "NBVSTRAJ", sizeof(magic)) == 0) {
+		initFromBinaryFile(fName, loadIndex, vortices, numDriverVorts, tracers);
+	} else if (magicLength == sizeof(magic) && memcmp(magic, "NBVSCHKP", sizeof(magic)) == 0) {
+		initFromCheckpoint(fName, vortices, numDriverVorts, tracers);
+	} else {
+		initFromTextFile(fName, loadIndex, vortices, numDriverVorts, tracers);
+	}
+}
@@ -14,10 +14,14 @@
 #include <stdio.h>
 
 void openFile(void);
-void saveState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortex *vorts, struct Tracer *tracers);
+void saveState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers);
+void saveState_binary(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers);
+double outputState(int timestep, long currentSeed, int numVorts, int numTracers, struct Vortices *vorts, struct Tracers *tracers);
 void saveIntermediateVortPositions(int numVorts, struct RKPositions *positions);
+void flushOutput(void);
 void closeFile(void);
 
-void initFromFile(char *fName, int loadIndex, struct Vortex *vortices[], int *numDriverVorts, int *vortsAllocated, struct Tracer *tracers[]);
+void saveCheckpoint(char *fName, int numVorts, struct Vortices *vorts, int numTracers, struct Tracers *tracers);
+void initFromFile(char *fName, int loadIndex, struct Vortices *vortices, int *numDriverVorts, struct Tracers *tracers);
 
 #endif /* SaveState_h */
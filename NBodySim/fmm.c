@@ -0,0 +1,403 @@
+//
+//  fmm.c
+//  NBodySim
+//
+
+#include "fmm.h"
+#include "constants.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define NUM_COEFFS (FMM_ORDER + 1)
+#define MAX_BINOMIAL (2 * FMM_ORDER + 2)
+
+/*
+ Expansions used (z_j are source positions, c is a box center):
+
+ multipole about c:    sum_j gamma_j/(z - z_j) = sum_k M_k / (z - c)^(k+1),   M_k = sum_j gamma_j (z_j - c)^k
+ local about c:        sum_j gamma_j/(z - z_j) = sum_l L_l (z - c)^l
+
+ M2M: M'_k = sum_m C(k,m) t^(k-m) M_m                     t = child center - parent center
+ M2L: L_l = (-1)^l sum_k C(k+l,k) M_k / t^(k+l+1)         t = target box center - source box center
+ L2L: L'_m = sum_l C(l,m) t^(l-m) L_l                     t = child center - parent center
+ */
+
+double binomials[MAX_BINOMIAL + 1][MAX_BINOMIAL + 1];
+char binomialsComputed = 0;
+
+static void computeBinomials() {
+    for (int n = 0; n <= MAX_BINOMIAL; n++) {
+        binomials[n][0] = 1;
+        for (int k = 1; k <= n; k++) {
+            binomials[n][k] = binomials[n-1][k-1] + ((k < n) ? binomials[n-1][k] : 0);
+        }
+    }
+    binomialsComputed = 1;
+}
+
+/**
+ index of the first box of a level in the multipole and local arrays
+ */
+static long levelOffset(struct FMM *fmm, int level) {
+    return fmm->topBoxesX * fmm->topBoxesY * (((1L << (2 * level)) - 1) / 3);
+}
+
+static long boxIndex(struct FMM *fmm, int level, int boxX, int boxY) {
+    return levelOffset(fmm, level) + (long)boxY * (fmm->topBoxesX << level) + boxX;
+}
+
+/**
+ center of a box. Box coordinates outside of the domain give the center of a periodic image of the box.
+ */
+static double complex boxCenter(struct FMM *fmm, int level, int boxX, int boxY) {
+    return (boxX + .5) * DOMAIN_SIZE_X / (fmm->topBoxesX << level) + (boxY + .5) * DOMAIN_SIZE_Y / (fmm->topBoxesY << level) * I;
+}
+
+/**
+ move a position into [0, size)
+ */
+static double wrapCoordinate(double coord, double size) {
+    coord -= size * floor(coord / size);
+    return (coord >= size) ? 0 : coord;
+}
+
+static int leafCoordinate(double coord, double size, int boxesPerSide) {
+    int box = (int)(coord / size * boxesPerSide);
+    return (box >= boxesPerSide) ? boxesPerSide - 1 : box;
+}
+
+static int wrapBox(int box, int boxesPerSide) {
+    box %= boxesPerSide;
+    return (box < 0) ? box + boxesPerSide : box;
+}
+
+/**
+ pick the level 0 grid and the block of near images for the current domain size, and compute the lattice sums
+ */
+static void setupDomain(struct FMM *fmm) {
+    double width = DOMAIN_SIZE_X;
+    double height = DOMAIN_SIZE_Y;
+
+    // level 0 boxes have to be close to square, otherwise well separated boxes can be too close for M2L to converge
+    double bestAspect = INFINITY;
+    for (int topY = 1; topY <= 8; topY++) {
+        int topX = (int)round(width / height * topY);
+        if (topX < 1) topX = 1;
+        double aspect = (width / topX) / (height / topY);
+        if (aspect < 1) aspect = 1 / aspect;
+        if (aspect < bestAspect - 1e-9) {
+            bestAspect = aspect;
+            fmm->topBoxesX = topX;
+            fmm->topBoxesY = topY;
+        }
+    }
+
+    int nearX, nearY;
+    chooseNearBlock(width, height, &nearX, &nearY);
+
+    freeLatticeSums(&fmm->lattice);
+    computeLatticeSums(&fmm->lattice, width, height, nearX, nearY, 2 * FMM_ORDER + 2);
+
+    fmm->boxesAllocated = 0; // the number of level 0 boxes may have changed
+    fmm->leavesAllocated = 0;
+}
+
+static void multipoleToMultipole(const double complex *childMultipole, double complex *parentMultipole, double complex shift) {
+    double complex shiftPowers[NUM_COEFFS];
+    shiftPowers[0] = 1;
+    for (int k = 1; k < NUM_COEFFS; k++) shiftPowers[k] = shiftPowers[k-1] * shift;
+
+    for (int k = 0; k < NUM_COEFFS; k++) {
+        double complex sum = 0;
+        for (int m = 0; m <= k; m++) sum += binomials[k][m] * shiftPowers[k-m] * childMultipole[m];
+        parentMultipole[k] += sum;
+    }
+}
+
+static void multipoleToLocal(const double complex *multipole, double complex *local, double complex shift) {
+    double complex inversePowers[2 * NUM_COEFFS];
+    double complex inverse = 1. / shift;
+    inversePowers[0] = 1;
+    for (int n = 1; n < 2 * NUM_COEFFS; n++) inversePowers[n] = inversePowers[n-1] * inverse;
+
+    for (int l = 0; l < NUM_COEFFS; l++) {
+        double complex sum = 0;
+        for (int k = 0; k < NUM_COEFFS; k++) sum += binomials[k+l][k] * multipole[k] * inversePowers[k+l+1];
+        local[l] += (l % 2) ? -sum : sum;
+    }
+}
+
+static void localToLocal(const double complex *parentLocal, double complex *childLocal, double complex shift) {
+    double complex shiftPowers[NUM_COEFFS];
+    shiftPowers[0] = 1;
+    for (int k = 1; k < NUM_COEFFS; k++) shiftPowers[k] = shiftPowers[k-1] * shift;
+
+    for (int m = 0; m < NUM_COEFFS; m++) {
+        double complex sum = 0;
+        for (int l = m; l < NUM_COEFFS; l++) sum += binomials[l][m] * shiftPowers[l-m] * parentLocal[l];
+        childLocal[m] += sum;
+    }
+}
+
+/**
+ add every periodic image of the domain outside of the near block to the domain's local expansion. This is M2L with the
+ 1/t^n factors replaced by lattice sums. The n = 1 and n = 2 sums only converge conditionally, so those are handled exactly
+ by the linear terms in fmmVelocity() instead.
+ */
+static void latticeToLocal(struct FMM *fmm, const double complex *rootMultipole, double complex *rootLocal) {
+    for (int l = 0; l < NUM_COEFFS; l++) {
+        double complex sum = 0;
+        for (int k = 0; k < NUM_COEFFS; k++) {
+            int n = k + l + 1;
+            if (n < 3 || n > fmm->lattice.maxPower) continue;
+            sum += binomials[k+l][k] * rootMultipole[k] * fmm->lattice.farSums[n];
+        }
+        rootLocal[l] += (l % 2) ? -sum : sum;
+    }
+}
+
+/**
+ Build the multipole and local expansions for a set of vortices. After this, the velocity at any point can be found with fmmVelocity().
+
+ @param fmm the FMM to (re)build. Memory from a previous build is reused
+ @param x array of vortex x-positions. These don't need to be inside of the driver domain
+ @param y array of vortex y-positions
+ @param gamma array of vortex intensities
+ @param numSources the length of the x, y and gamma arrays
+ */
+void buildFMM(struct FMM *fmm, const double *x, const double *y, const double *gamma, int numSources) {
+    if (!binomialsComputed) computeBinomials();
+
+    if (fmm->lattice.farSums == NULL || fmm->lattice.width != DOMAIN_SIZE_X || fmm->lattice.height != DOMAIN_SIZE_Y) {
+        setupDomain(fmm);
+    }
+
+    int numTopBoxes = fmm->topBoxesX * fmm->topBoxesY;
+    int levels = 0;
+    while (levels < FMM_MAX_LEVEL && (long)numTopBoxes * (1L << (2 * levels)) * FMM_LEAF_SIZE < numSources) levels++;
+    fmm->levels = levels;
+
+    int leavesX = fmm->topBoxesX << levels;
+    int leavesY = fmm->topBoxesY << levels;
+    int numLeaves = leavesX * leavesY;
+    long numBoxes = levelOffset(fmm, levels + 1);
+
+    if (numBoxes > fmm->boxesAllocated) {
+        fmm->boxesAllocated = numBoxes;
+        fmm->multipoles = countedRealloc(fmm->multipoles, sizeof(double complex) * NUM_COEFFS * numBoxes);
+        fmm->locals = countedRealloc(fmm->locals, sizeof(double complex) * NUM_COEFFS * numBoxes);
+    }
+    if (numLeaves > fmm->leavesAllocated) {
+        fmm->leavesAllocated = numLeaves;
+        fmm->leafStart = countedRealloc(fmm->leafStart, sizeof(int) * (numLeaves + 1));
+        fmm->leafFill = countedRealloc(fmm->leafFill, sizeof(int) * numLeaves);
+    }
+    if (numSources > fmm->sourcesAllocated) {
+        fmm->sourcesAllocated = numSources * 1.5;
+        fmm->sourceX = countedRealloc(fmm->sourceX, sizeof(double) * fmm->sourcesAllocated);
+        fmm->sourceY = countedRealloc(fmm->sourceY, sizeof(double) * fmm->sourcesAllocated);
+        fmm->sourceGamma = countedRealloc(fmm->sourceGamma, sizeof(double) * fmm->sourcesAllocated);
+        fmm->sourceIndex = countedRealloc(fmm->sourceIndex, sizeof(int) * fmm->sourcesAllocated);
+    }
+    if (fmm->multipoles == NULL || fmm->locals == NULL || fmm->leafStart == NULL || fmm->leafFill == NULL || (numSources && fmm->sourceIndex == NULL)) {
+        printf("Error reallocating FMM arrays");
+        exit(1);
+    }
+    fmm->numSources = numSources;
+
+    memset(fmm->multipoles, 0, sizeof(double complex) * NUM_COEFFS * numBoxes);
+    memset(fmm->locals, 0, sizeof(double complex) * NUM_COEFFS * numBoxes);
+    memset(fmm->rootMultipole, 0, sizeof(fmm->rootMultipole));
+    memset(fmm->rootLocal, 0, sizeof(fmm->rootLocal));
+
+    // counting sort of the sources into leaves
+    memset(fmm->leafStart, 0, sizeof(int) * (numLeaves + 1));
+    for (int i = 0; i < numSources; i++) {
+        int leafX = leafCoordinate(wrapCoordinate(x[i], DOMAIN_SIZE_X), DOMAIN_SIZE_X, leavesX);
+        int leafY = leafCoordinate(wrapCoordinate(y[i], DOMAIN_SIZE_Y), DOMAIN_SIZE_Y, leavesY);
+        fmm->leafStart[leafY * leavesX + leafX + 1]++;
+    }
+    for (int leaf = 0; leaf < numLeaves; leaf++) fmm->leafStart[leaf + 1] += fmm->leafStart[leaf];
+
+    int *leafFill = fmm->leafFill;
+    memcpy(leafFill, fmm->leafStart, sizeof(int) * numLeaves);
+
+    fmm->totalGamma = 0;
+    fmm->firstMoment = 0;
+    for (int i = 0; i < numSources; i++) {
+        double wrappedX = wrapCoordinate(x[i], DOMAIN_SIZE_X);
+        double wrappedY = wrapCoordinate(y[i], DOMAIN_SIZE_Y);
+        int leaf = leafCoordinate(wrappedY, DOMAIN_SIZE_Y, leavesY) * leavesX + leafCoordinate(wrappedX, DOMAIN_SIZE_X, leavesX);
+        int sorted = leafFill[leaf]++;
+
+        fmm->sourceX[sorted] = wrappedX;
+        fmm->sourceY[sorted] = wrappedY;
+        fmm->sourceGamma[sorted] = gamma[i];
+        fmm->sourceIndex[sorted] = i;
+
+        fmm->totalGamma += gamma[i];
+        fmm->firstMoment += gamma[i] * (wrappedX + wrappedY * I);
+    }
+
+    // P2M
+    for (int leaf = 0; leaf < numLeaves; leaf++) {
+        double complex center = boxCenter(fmm, levels, leaf % leavesX, leaf / leavesX);
+        double complex *multipole = &fmm->multipoles[boxIndex(fmm, levels, leaf % leavesX, leaf / leavesX) * NUM_COEFFS];
+
+        for (int i = fmm->leafStart[leaf]; i < fmm->leafStart[leaf + 1]; i++) {
+            double complex offset = fmm->sourceX[i] + fmm->sourceY[i] * I - center;
+            double complex power = fmm->sourceGamma[i];
+            for (int k = 0; k < NUM_COEFFS; k++) {
+                multipole[k] += power;
+                power *= offset;
+            }
+        }
+    }
+
+    // M2M, from the leaves up to level 0, then to the whole domain
+    for (int level = levels - 1; level >= 0; level--) {
+        int parentsX = fmm->topBoxesX << level;
+        int parentsY = fmm->topBoxesY << level;
+        for (int parentY = 0; parentY < parentsY; parentY++) {
+            for (int parentX = 0; parentX < parentsX; parentX++) {
+                double complex parentCenter = boxCenter(fmm, level, parentX, parentY);
+                double complex *parentMultipole = &fmm->multipoles[boxIndex(fmm, level, parentX, parentY) * NUM_COEFFS];
+
+                for (int child = 0; child < 4; child++) {
+                    int childX = 2 * parentX + (child & 1);
+                    int childY = 2 * parentY + (child >> 1);
+                    double complex *childMultipole = &fmm->multipoles[boxIndex(fmm, level + 1, childX, childY) * NUM_COEFFS];
+                    multipoleToMultipole(childMultipole, parentMultipole, boxCenter(fmm, level + 1, childX, childY) - parentCenter);
+                }
+            }
+        }
+    }
+
+    double complex domainCenter = DOMAIN_SIZE_X / 2. + DOMAIN_SIZE_Y / 2. * I;
+    for (int topY = 0; topY < fmm->topBoxesY; topY++) {
+        for (int topX = 0; topX < fmm->topBoxesX; topX++) {
+            double complex *multipole = &fmm->multipoles[boxIndex(fmm, 0, topX, topY) * NUM_COEFFS];
+            multipoleToMultipole(multipole, fmm->rootMultipole, boxCenter(fmm, 0, topX, topY) - domainCenter);
+        }
+    }
+
+    // everything outside of the near block of images
+    latticeToLocal(fmm, fmm->rootMultipole, fmm->rootLocal);
+
+    // level 0 boxes get the far field from the domain's local expansion, and M2L from every box in the near block of
+    // images which isn't adjacent to them. Box coordinates outside of the domain are periodic images.
+    int nearX = fmm->lattice.nearX, nearY = fmm->lattice.nearY;
+    for (int topY = 0; topY < fmm->topBoxesY; topY++) {
+        for (int topX = 0; topX < fmm->topBoxesX; topX++) {
+            double complex center = boxCenter(fmm, 0, topX, topY);
+            double complex *local = &fmm->locals[boxIndex(fmm, 0, topX, topY) * NUM_COEFFS];
+            localToLocal(fmm->rootLocal, local, center - domainCenter);
+
+            for (int sourceY = -nearY * fmm->topBoxesY; sourceY < (nearY + 1) * fmm->topBoxesY; sourceY++) {
+                for (int sourceX = -nearX * fmm->topBoxesX; sourceX < (nearX + 1) * fmm->topBoxesX; sourceX++) {
+                    if (abs(sourceX - topX) <= 1 && abs(sourceY - topY) <= 1) continue; // near field
+
+                    double complex *multipole = &fmm->multipoles[boxIndex(fmm, 0, wrapBox(sourceX, fmm->topBoxesX), wrapBox(sourceY, fmm->topBoxesY)) * NUM_COEFFS];
+                    multipoleToLocal(multipole, local, center - boxCenter(fmm, 0, sourceX, sourceY));
+                }
+            }
+        }
+    }
+
+    // M2L and L2L, down to the leaves. The interaction list of a box is the children of its parent's neighbors
+    // which aren't neighbors of the box itself.
+    for (int level = 1; level <= levels; level++) {
+        int boxesX = fmm->topBoxesX << level;
+        int boxesY = fmm->topBoxesY << level;
+
+        for (int boxY = 0; boxY < boxesY; boxY++) {
+            for (int boxX = 0; boxX < boxesX; boxX++) {
+                double complex center = boxCenter(fmm, level, boxX, boxY);
+                double complex *local = &fmm->locals[boxIndex(fmm, level, boxX, boxY) * NUM_COEFFS];
+
+                int parentX = boxX / 2, parentY = boxY / 2;
+                localToLocal(&fmm->locals[boxIndex(fmm, level - 1, parentX, parentY) * NUM_COEFFS], local, center - boxCenter(fmm, level - 1, parentX, parentY));
+
+                for (int sourceY = 2 * parentY - 2; sourceY <= 2 * parentY + 3; sourceY++) {
+                    for (int sourceX = 2 * parentX - 2; sourceX <= 2 * parentX + 3; sourceX++) {
+                        if (abs(sourceX - boxX) <= 1 && abs(sourceY - boxY) <= 1) continue; // near field
+
+                        double complex *multipole = &fmm->multipoles[boxIndex(fmm, level, wrapBox(sourceX, boxesX), wrapBox(sourceY, boxesY)) * NUM_COEFFS];
+                        multipoleToLocal(multipole, local, center - boxCenter(fmm, level, sourceX, sourceY));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void freeFMM(struct FMM *fmm) {
+    free(fmm->multipoles);
+    free(fmm->locals);
+    free(fmm->leafStart);
+    free(fmm->leafFill);
+    free(fmm->sourceX);
+    free(fmm->sourceY);
+    free(fmm->sourceGamma);
+    free(fmm->sourceIndex);
+    freeLatticeSums(&fmm->lattice);
+    memset(fmm, 0, sizeof(struct FMM));
+}
+
+/**
+ Calculate the velocity induced at a point by every vortex in the FMM and all of their periodic images.
+
+ @param fmm an FMM built by buildFMM()
+ @param x the x-position of the target
+ @param y the y-position of the target
+ @param selfIndex the source index of the target if it is one of the vortices in the FMM, otherwise -1
+ @param xVel Pointer to a double which will be incremented by the x-velocity at the target
+ @param yVel Pointer to a double which will be incremented by the y-velocity at the target
+ */
+void fmmVelocity(struct FMM *fmm, double x, double y, int selfIndex, double *xVel, double *yVel) {
+    if (fmm->numSources == 0) return;
+
+    int leavesX = fmm->topBoxesX << fmm->levels;
+    int leavesY = fmm->topBoxesY << fmm->levels;
+    double wrappedX = wrapCoordinate(x, DOMAIN_SIZE_X);
+    double wrappedY = wrapCoordinate(y, DOMAIN_SIZE_Y);
+    double complex z = wrappedX + wrappedY * I;
+    int leafX = leafCoordinate(wrappedX, DOMAIN_SIZE_X, leavesX);
+    int leafY = leafCoordinate(wrappedY, DOMAIN_SIZE_Y, leavesY);
+
+    // far field, from the leaf's local expansion
+    double complex *local = &fmm->locals[boxIndex(fmm, fmm->levels, leafX, leafY) * NUM_COEFFS];
+    double complex offset = z - boxCenter(fmm, fmm->levels, leafX, leafY);
+    double complex w = local[FMM_ORDER];
+    for (int l = FMM_ORDER - 1; l >= 0; l--) w = w * offset + local[l];
+
+    // near field, directly from the 3x3 neighboring leaves
+    for (int neighborY = leafY - 1; neighborY <= leafY + 1; neighborY++) {
+        for (int neighborX = leafX - 1; neighborX <= leafX + 1; neighborX++) {
+            int wrappedLeafX = wrapBox(neighborX, leavesX);
+            int wrappedLeafY = wrapBox(neighborY, leavesY);
+            int leaf = wrappedLeafY * leavesX + wrappedLeafX;
+
+            // shifting the target by -offset is the same as shifting the leaf's sources by +offset
+            double complex shift = (neighborX - wrappedLeafX) / leavesX * DOMAIN_SIZE_X + (neighborY - wrappedLeafY) / leavesY * DOMAIN_SIZE_Y * I;
+            double complex shiftedZ = z - shift;
+            char isImage = (neighborX != wrappedLeafX || neighborY != wrappedLeafY);
+
+            for (int i = fmm->leafStart[leaf]; i < fmm->leafStart[leaf + 1]; i++) {
+                if (fmm->sourceIndex[i] == selfIndex && !isImage) continue;
+                w += fmm->sourceGamma[i] / (shiftedZ - (fmm->sourceX[i] + fmm->sourceY[i] * I));
+            }
+        }
+    }
+
+    // the conditionally convergent part of the lattice sum, and the uniform background vorticity
+    w += fmm->lattice.linearCoefficient * (fmm->totalGamma * z - fmm->firstMoment);
+    w += fmm->lattice.conjugateCoefficient * (fmm->totalGamma * conj(z) - conj(fmm->firstMoment));
+
+    // u - iv = w / (2*pi*i)
+    *xVel += cimag(w) / (2 * M_PI);
+    *yVel += creal(w) / (2 * M_PI);
+}
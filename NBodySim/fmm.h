@@ -0,0 +1,59 @@
+//
+//  fmm.h
+//  NBodySim
+//
+
+#ifndef fmm_h
+#define fmm_h
+
+#include <complex.h>
+#include "lattice.h"
+
+#define FMM_ORDER 24 // highest power kept in the multipole and local expansions
+#define FMM_LEAF_SIZE 32 // the tree is refined until there are about this many vortices per leaf box
+#define FMM_MAX_LEVEL 8
+
+/*
+ Fast multipole method for the doubly periodic point vortex velocity
+
+    u - iv = 1/(2*pi*i) * sum_j gamma_j * K(z - z_j)
+
+ where K is the periodic kernel described in lattice.h. The domain is first split into a grid of
+ topBoxesX x topBoxesY boxes (level 0) that are as close to square as possible, and each of those is the
+ root of a uniform quadtree. Every periodic image of the domain outside of the near block of images is
+ added to the local expansion of the whole domain through lattice sums, so unlike the direct solver
+ there is no truncation radius.
+ */
+struct FMM {
+    int topBoxesX;
+    int topBoxesY;
+    int levels; // leaf boxes are at this level
+    long boxesAllocated;
+    int leavesAllocated;
+    double complex *multipoles; // (FMM_ORDER + 1) coefficients per box, boxes stored level by level
+    double complex *locals;
+
+    // sources, wrapped into the domain and sorted into leaf boxes
+    int numSources;
+    int sourcesAllocated;
+    double *sourceX;
+    double *sourceY;
+    double *sourceGamma;
+    int *sourceIndex; // original index of each sorted source
+    int *leafStart; // sources in leaf b are sourceX[leafStart[b]] to sourceX[leafStart[b+1] - 1]
+    int *leafFill; // scratch space for sorting the sources into leaves
+
+    double complex rootMultipole[FMM_ORDER + 1]; // expansions of the whole domain about its center
+    double complex rootLocal[FMM_ORDER + 1];
+
+    double totalGamma; // sum of gamma_j
+    double complex firstMoment; // sum of gamma_j * z_j
+
+    struct LatticeSums lattice;
+};
+
+void buildFMM(struct FMM *fmm, const double *x, const double *y, const double *gamma, int numSources);
+void freeFMM(struct FMM *fmm);
+void fmmVelocity(struct FMM *fmm, double x, double y, int selfIndex, double *xVel, double *yVel);
+
+#endif /* fmm_h */
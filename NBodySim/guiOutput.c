@@ -20,7 +20,7 @@ void genFName(char *strBuffer, int frameNum) {
 	strcat(strBuffer, ".png");
 }
 
-void drawToConsole(struct Vortex *vorts, int numVorts, struct Tracer *tracers) {
+void drawToConsole(struct Vortices *vorts, int numVorts, struct Tracers *tracers) {
 	printf("\033[3J");
 	printf("CONSOLE_W: %i | CONSOLE_H: %i\n", CONSOLE_W, CONSOLE_H);
 	int pxArray[CONSOLE_W][CONSOLE_H];
@@ -33,17 +33,17 @@ void drawToConsole(struct Vortex *vorts, int numVorts, struct Tracer *tracers) {
 	}
 	
 	for (int i = 0; i < NUM_TRACERS; i++) {
-		int xPxCoord = (int)(CONSOLE_W-1)*tracers[i].position[0]/DOMAIN_SIZE_X;
-		int yPxCoord = (int)(CONSOLE_H-1)*tracers[i].position[1]/DOMAIN_SIZE_Y;
+		int xPxCoord = (int)(CONSOLE_W-1)*tracers->x[i]/DOMAIN_SIZE_X;
+		int yPxCoord = (int)(CONSOLE_H-1)*tracers->y[i]/DOMAIN_SIZE_Y;
 		
 		pxArray[xPxCoord][yPxCoord] = -2;
 	}
 	
 	for (int i = 0; i < numVorts; i++) {
-		int xPxCoord = (int)(CONSOLE_W-1)*vorts[i].position[0]/DOMAIN_SIZE_X;
-		int yPxCoord = (int)(CONSOLE_H-1)*vorts[i].position[1]/DOMAIN_SIZE_Y;
+		int xPxCoord = (int)(CONSOLE_W-1)*vorts->x[i]/DOMAIN_SIZE_X;
+		int yPxCoord = (int)(CONSOLE_H-1)*vorts->y[i]/DOMAIN_SIZE_Y;
 
-		pxArray[xPxCoord][yPxCoord] = vorts[i].vIndex;
+		pxArray[xPxCoord][yPxCoord] = i;
 	}
 	int count = 0;
 	for (int y = CONSOLE_H-1; y >= 0; y--) {
@@ -52,7 +52,7 @@ void drawToConsole(struct Vortex *vorts, int numVorts, struct Tracer *tracers) {
 			if (pxArray[x][y] >= 0) {
 				int indexStrLen = (pxArray[x][y] == 0) ? 1 : ceil(log10(pxArray[x][y] + 1));
 				for (int j = 0; j < indexStrLen; j++) printf("\010");
-				if (vorts[pxArray[x][y]].intensity > 0) {
+				if (vorts->gamma[pxArray[x][y]] > 0) {
 					printf("\033[91m");
 				} else {
 					printf("\033[94m");
@@ -69,7 +69,7 @@ void drawToConsole(struct Vortex *vorts, int numVorts, struct Tracer *tracers) {
 	}
 }
 
-void drawToFile(struct Vortex *vorts, int numVorts, struct Tracer *tracers, char filename[]) {
+void drawToFile(struct Vortices *vorts, int numVorts, struct Tracers *tracers, char filename[]) {
 	cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, IMAGE_W, IMAGE_H);
 	cairo_t *cr = cairo_create(surface);
 	
@@ -79,13 +79,11 @@ void drawToFile(struct Vortex *vorts, int numVorts, struct Tracer *tracers, char
 	cairo_paint(cr);
 	
 	for (int vortIndex = 0; vortIndex < numVorts; vortIndex++) {
-		struct Vortex *vort = &vorts[vortIndex];
+		double xPos = IMAGE_W * vorts->x[vortIndex] / DOMAIN_SIZE_X;
+		double yPos = IMAGE_H * vorts->y[vortIndex] / DOMAIN_SIZE_Y;
+		double rad = sqrt(fabs(vorts->gamma[vortIndex])) * VORTEX_DRAW_SIZE_CONST * (IMAGE_W/1000.);
 		
-		double xPos = IMAGE_W * vort->position[0] / DOMAIN_SIZE_X;
-		double yPos = IMAGE_H * vort->position[1] / DOMAIN_SIZE_Y;
-		double rad = sqrt(fabs(vort->intensity)) * VORTEX_DRAW_SIZE_CONST * (IMAGE_W/1000.);
-		
-		if (vort->intensity > 0) {
+		if (vorts->gamma[vortIndex] > 0) {
 			cairo_set_source_rgb(cr, 1, 0, 0);
 		} else {
 			cairo_set_source_rgb(cr, 0, 0, 1);
@@ -101,10 +99,8 @@ void drawToFile(struct Vortex *vorts, int numVorts, struct Tracer *tracers, char
 	
 	int i = 0;
 	for (int tracerIndex = 0; tracerIndex < NUM_TRACERS; tracerIndex++) {
-		struct Tracer *tracer = &tracers[tracerIndex];
-		
-		double xPos = IMAGE_W * tracer->position[0] / DOMAIN_SIZE_X;
-		double yPos = IMAGE_H * tracer->position[1] / DOMAIN_SIZE_Y;
+		double xPos = IMAGE_W * tracers->x[tracerIndex] / DOMAIN_SIZE_X;
+		double yPos = IMAGE_H * tracers->y[tracerIndex] / DOMAIN_SIZE_Y;
 		double rad = TRACER_DRAW_SIZE_CONST * IMAGE_W/1000.;
 		
 		cairo_new_sub_path(cr);
@@ -1,13 +1,13 @@
 #ifndef guiOutput_h
 #define guiOutput_h
 
-struct Tracer;
-struct Vortex;
+struct Tracers;
+struct Vortices;
 
 void genFName(char *strBuffer, int frameNum);
 
-void drawToConsole(struct Vortex *vorts, int numVorts, struct Tracer *tracers);
-void drawToScreen(struct Vortex *vorts, int numVorts, struct Tracer *tracers);
-void drawToFile(struct Vortex *vorts, int numVorts, struct Tracer *tracers, char filename[]);
+void drawToConsole(struct Vortices *vorts, int numVorts, struct Tracers *tracers);
+void drawToScreen(struct Vortices *vorts, int numVorts, struct Tracers *tracers);
+void drawToFile(struct Vortices *vorts, int numVorts, struct Tracers *tracers, char filename[]);
 
 #endif
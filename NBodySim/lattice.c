@@ -0,0 +1,174 @@
+//
+//  lattice.c
+//  NBodySim
+//
+
+#include "lattice.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <complex.h>
+
+#define DIRECT_SUM_RINGS 256 // lattice sums of w^-n with n >= 8 are summed directly out to this many rings
+
+/**
+ Riemann zeta function for integer n >= 2, using Euler-Maclaurin for the tail of the series
+ */
+static double riemannZeta(int n) {
+    const int terms = 100;
+    double sum = 0;
+    for (int m = terms - 1; m >= 1; m--) sum += pow(m, -n);
+
+    double M = terms;
+    sum += pow(M, 1 - n) / (n - 1) + pow(M, -n) / 2 + n * pow(M, -n - 1) / 12;
+    return sum;
+}
+
+/**
+ Eisenstein series G_n for the lattice {m + n*tau} with tau = i*r, from its q-expansion:
+
+    G_n = 2*zeta(n) + 2*(2*pi*i)^n/(n-1)! * sum_k sigma_(n-1)(k) q^k,   q = e^(-2*pi*r)
+
+ For n = 2 this is the conditionally convergent sum taken over m first, which gives eta_1 = G_2/2.
+
+ @param n an even integer >= 2
+ @param r the imaginary part of tau
+ */
+static double eisensteinSeries(int n, double r) {
+    double logCoefficient = log(2.) + n * log(2 * M_PI) - lgamma(n);
+    double sign = ((n/2) % 2) ? -1 : 1; // i^n
+    double sum = 0;
+
+    for (int k = 1; k < 100000; k++) {
+        double term = 0;
+        for (int d = 1; d <= k; d++) {
+            if (k % d) continue;
+            term += exp(logCoefficient + (n - 1) * log(d) - 2 * M_PI * r * k);
+        }
+        sum += term;
+        if (term < 1e-18 * fabs(sum) && 2 * M_PI * r * k > n * log(k + 1.) + logCoefficient) break;
+    }
+    return 2 * riemannZeta(n) + sign * sum;
+}
+
+/**
+ Compute the lattice sums needed to evaluate the periodic kernel for a rectangular domain.
+
+ @param sums the struct to fill in
+ @param width the size of the domain in the x-direction
+ @param height the size of the domain in the y-direction
+ @param nearX images with |m| <= nearX (and |n| <= nearY) are left out of the far sums
+ @param nearY images with |n| <= nearY (and |m| <= nearX) are left out of the far sums
+ @param maxPower the highest n for which farSums[n] is needed
+ */
+void computeLatticeSums(struct LatticeSums *sums, double width, double height, int nearX, int nearY, int maxPower) {
+    sums->width = width;
+    sums->height = height;
+    sums->nearX = nearX;
+    sums->nearY = nearY;
+    sums->maxPower = maxPower;
+    sums->farSums = calloc(maxPower + 1, sizeof(double));
+
+    // sums of w^-n over the near block, not including w = 0
+    double complex *nearSums = calloc(maxPower + 1, sizeof(double complex));
+    for (int m = -nearX; m <= nearX; m++) {
+        for (int n = -nearY; n <= nearY; n++) {
+            if (!m && !n) continue;
+
+            double complex inverse = 1. / (m * width + n * height * I);
+            double complex power = 1;
+            for (int p = 1; p <= maxPower; p++) {
+                power *= inverse;
+                nearSums[p] += power;
+            }
+        }
+    }
+
+    // n = 4 and 6 converge too slowly to sum directly, so they come from the eisenstein series. The series
+    // converges fastest with the longer period as tau, so the lattice is rotated by 90 degrees if needed.
+    for (int n = 4; n <= maxPower && n <= 6; n += 2) {
+        double total;
+        if (height >= width) {
+            total = eisensteinSeries(n, height / width) * pow(width, -n);
+        } else {
+            double rotation = ((n/2) % 2) ? -1 : 1; // i^-n
+            total = rotation * eisensteinSeries(n, width / height) * pow(height, -n);
+        }
+        sums->farSums[n] = total - creal(nearSums[n]);
+    }
+
+    // everything else converges quickly, so it is summed ring by ring outside of the near block
+    if (maxPower >= 8) {
+        double complex *ringSums = calloc(maxPower + 1, sizeof(double complex));
+        for (int ring = DIRECT_SUM_RINGS; ring >= 1; ring--) { // smallest terms first
+            for (int m = -ring; m <= ring; m++) {
+                for (int n = -ring; n <= ring; n++) {
+                    if (abs(m) != ring && abs(n) != ring) continue;
+                    if (abs(m) <= nearX && abs(n) <= nearY) continue;
+
+                    double complex inverse = 1. / (m * width + n * height * I);
+                    double complex inverseSquared = inverse * inverse;
+                    double complex power = inverseSquared * inverseSquared * inverseSquared;
+                    for (int p = 8; p <= maxPower; p += 2) {
+                        power *= inverseSquared;
+                        ringSums[p] += power;
+                    }
+                }
+            }
+        }
+        for (int p = 8; p <= maxPower; p += 2) sums->farSums[p] = creal(ringSums[p]);
+        free(ringSums);
+    }
+
+    // pick a and b so that zeta(z) + a*z + b*conj(z) is periodic, using the quasi-periods zeta(z + 2w_k) = zeta(z) + 2*eta_k
+    // and the Legendre relation. The sum of w^-2 over the near block is moved into the linear term as well.
+    double area = width * height;
+    double eta1 = eisensteinSeries(2, height / width) / (2 * width);
+
+    sums->linearCoefficient = -2 * eta1 / width + M_PI / area + ((maxPower >= 2) ? creal(nearSums[2]) : 0);
+    sums->conjugateCoefficient = -M_PI / area;
+    free(nearSums);
+}
+
+/**
+ Pick the smallest block of near images which keeps every far image at least 1.4x the domain diagonal away from the
+ origin. The series in lattice.h then converges at least as fast as (0.5/1.4)^n anywhere within half a diagonal of the origin,
+ which covers every minimum image separation.
+ */
+void chooseNearBlock(double width, double height, int *nearX, int *nearY) {
+    double diagonal = sqrt(width * width + height * height);
+    *nearX = 1;
+    *nearY = 1;
+    while ((*nearX + 1) * width < 1.4 * diagonal) (*nearX)++;
+    while ((*nearY + 1) * height < 1.4 * diagonal) (*nearY)++;
+}
+
+/**
+ Evaluate the analytic part of the periodic kernel, K(z) - 1/z - conjugateCoefficient*conj(z), from the near block and the far sums.
+
+ @param sums lattice sums from computeLatticeSums()
+ @param z a point closer to the origin than to any lattice point outside of the near block
+ */
+double complex smoothKernel(const struct LatticeSums *sums, double complex z) {
+    double complex result = sums->linearCoefficient * z;
+
+    for (int m = -sums->nearX; m <= sums->nearX; m++) {
+        for (int n = -sums->nearY; n <= sums->nearY; n++) {
+            if (!m && !n) continue;
+            result += 1. / (z - (m * sums->width + n * sums->height * I));
+        }
+    }
+
+    // Horner's rule over the odd powers z^(n-1), highest first
+    double complex zSquared = z * z;
+    double complex series = 0;
+    for (int n = sums->maxPower - (sums->maxPower % 2); n >= 4; n -= 2) series = series * zSquared + sums->farSums[n];
+    result -= series * zSquared * z;
+
+    return result;
+}
+
+void freeLatticeSums(struct LatticeSums *sums) {
+    free(sums->farSums);
+    sums->farSums = NULL;
+}
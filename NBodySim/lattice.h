@@ -0,0 +1,45 @@
+//
+//  lattice.h
+//  NBodySim
+//
+
+#ifndef lattice_h
+#define lattice_h
+
+#include <complex.h>
+
+/*
+ Lattice sums for the doubly periodic point vortex kernel.
+
+ The velocity induced at z by a vortex at z_j and all of its periodic images is
+
+    u - iv = gamma/(2*pi*i) * K(z - z_j),   K(z) = zeta(z) + a*z + b*conj(z)
+
+ where zeta is the Weierstrass zeta function of the lattice {m*DOMAIN_SIZE_X + i*n*DOMAIN_SIZE_Y}. a and b
+ are the unique constants which make K periodic. b = -pi/area is a uniform background vorticity which
+ cancels the net circulation of the domain.
+
+ Removing a block of near images w = m*width + i*n*height with |m| <= nearX and |n| <= nearY leaves a smooth function:
+
+    K(z) - sum_{near} 1/(z - w) = linearCoefficient*z + conjugateCoefficient*conj(z) - sum_n farSums[n] * z^(n-1)
+
+ The series converges for |z| smaller than the distance to the closest lattice point outside of the near block.
+ */
+struct LatticeSums {
+    double width;
+    double height;
+    int nearX;
+    int nearY;
+    int maxPower;
+
+    double *farSums; // farSums[n] = sum of w^-n over every lattice point w outside the near block. 0 for odd n
+    double linearCoefficient;
+    double conjugateCoefficient;
+};
+
+void computeLatticeSums(struct LatticeSums *sums, double width, double height, int nearX, int nearY, int maxPower);
+void chooseNearBlock(double width, double height, int *nearX, int *nearY);
+double complex smoothKernel(const struct LatticeSums *sums, double complex z);
+void freeLatticeSums(struct LatticeSums *sums);
+
+#endif /* lattice_h */
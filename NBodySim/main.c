@@ -10,7 +10,14 @@
 #include "TestCaseInitializers.h"
 #include "fileIO.h"
 #include "RNG.h"
-#include "C-Thread-Pool/thpool.h"
+#include "quadtree.h"
+#include "fmm.h"
+#include "particleMesh.h"
+#include "periodicKernel.h"
+#include "biotSavart.h"
+#include "team.h"
+#include "cellList.h"
+#include "allocations.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,6 +28,7 @@
 #include <string.h>
 #include <limits.h>
 #include <signal.h>
+#include <sys/mman.h>
 
 #undef DEBUG
 
@@ -28,14 +36,15 @@ unsigned int randomSeed;
 double timestep;
 int currentTimestep;
 int numDriverVorts;
-threadpool thpool;
+int tracerRadiiStride; // vortices the radii arrays have room for, which is also the length of each tracer's row of the tracer radii
+struct DirtyRadii dirtyRadii;
 
 #pragma mark - Index Calculators
 
 /**
   This function return the index in the vortex radii array for the radius between a pair of vortices
 
-  @param vortIndex1 the index of one of the vortices. Can be found by examining the vIndex value of the vortex in question
+  @param vortIndex1 the index of one of the vortices. This is its position in the vortex arrays
   @param vortIndex2 the index of the other vortex
 
   @return Index of the radius value
@@ -55,8 +64,8 @@ long calculateVortexRadiiIndex(long vortIndex1, long vortIndex2) {
 /**
   Calculates the index in the tracer radii array for the radius between a specific tracer and a specific vortex
 
-  @param tracerIndex the index of the tracer. Can be found by exmaining the tIndex of the tracer in question
-  @param vortIndex the index of the vortex. Can be found by examining the vIndex of the vortex in question
+  @param tracerIndex the index of the tracer. This is its position in the tracer arrays
+  @param vortIndex the index of the vortex. This is its position in the vortex arrays
   @return The index in the tracer radii array of the radius
   */
 
@@ -68,56 +77,402 @@ long calculateTracerRadiiIndex(long tracerIndex, long vortIndex) {
        */
 
     // return (vortIndex * numTracers + tracerIndex)*3;
-    return (tracerIndex * numDriverVorts + vortIndex) * 3;
+    // the rows are as long as the radii arrays' capacity rather than numDriverVorts, so they don't move when vortices are spawned or deleted
+    return (tracerIndex * tracerRadiiStride + vortIndex) * 3;
+}
+
+#pragma mark - Particle Storage
+
+/**
+  The O(N^2) radii arrays are only needed by the direct solver's radii integrator, @c stepForward_RK4(). Every other
+  integrator works from the particle positions, and the radii arrays aren't allocated at all.
+
+  @return true if the radii arrays are in use
+  */
+char useRadiiArrays(void) {
+    return VELOCITY_SOLVER == SOLVER_DIRECT && !RADII_FREE;
+}
+
+/**
+  grow or shrink every vortex array to hold a number of vortices. Existing vortices are kept.
+
+  All of the arrays are carved out of one block, so spawning and deleting vortices never goes to the allocator, resizing them is one
+  allocation and one copy of the live vortices, and freeing them is one call. The 8 byte fields come first so that every array is aligned.
+
+  @param vortices the vortex arrays
+  @param allocated the new length of each array. Must be at least numDriverVorts, and more than 0
+  */
+void resizeVortices(struct Vortices *vortices, int allocated) {
+    size_t bytesPerVortex = sizeof(long) + sizeof(double) * 5 + sizeof(int);
+    char *block = countedRealloc(NULL, bytesPerVortex * allocated);
+    if (block == NULL) {
+        printf("Error reallocating vorts array");
+        exit(1);
+    }
+
+    struct Vortices resized = {0};
+    resized.allocated = allocated;
+    resized.id = (long *)block;
+    resized.x = (double *)(resized.id + allocated);
+    resized.y = resized.x + allocated;
+    resized.u = resized.y + allocated;
+    resized.v = resized.u + allocated;
+    resized.gamma = resized.v + allocated;
+    resized.initStep = (int *)(resized.gamma + allocated);
+
+    int kept = (vortices->allocated < allocated) ? vortices->allocated : allocated;
+    if (kept > 0) {
+        memcpy(resized.id, vortices->id, sizeof(long) * kept);
+        memcpy(resized.x, vortices->x, sizeof(double) * kept);
+        memcpy(resized.y, vortices->y, sizeof(double) * kept);
+        memcpy(resized.u, vortices->u, sizeof(double) * kept);
+        memcpy(resized.v, vortices->v, sizeof(double) * kept);
+        memcpy(resized.gamma, vortices->gamma, sizeof(double) * kept);
+        memcpy(resized.initStep, vortices->initStep, sizeof(int) * kept);
+    }
+    freeVortices(vortices);
+    *vortices = resized;
+}
+
+/**
+  free the vortex arrays, which all live in the block starting at id
+  */
+void freeVortices(struct Vortices *vortices) {
+    free(vortices->id);
+    memset(vortices, 0, sizeof(struct Vortices));
+}
+
+/**
+  reserve address space for one of the radii arrays. The OS only gives a page memory the first time it's touched, so a reservation for
+  far more vortices than are alive costs nothing until they are spawned, and the array grows one page at a time without being copied.
+
+  @param length the number of doubles to reserve room for
+  @return the start of the array, or NULL if length is 0 or the space couldn't be reserved
+  */
+double *reserveRadii(long length) {
+    if (length == 0) return NULL;
+
+    countAllocation();
+    void *radii = mmap(NULL, sizeof(double) * length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return (radii == MAP_FAILED) ? NULL : radii;
+}
+
+/**
+  @return the number of doubles in a vortex radii array for a number of vortices
+  */
+long vortexRadiiLength(int capacity) {
+    return ((long)capacity * (capacity-1))/2 * 3; // # of edges in a complete graph of capacity nodes
+}
+
+/**
+  release the radii arrays, which were reserved for tracerRadiiStride vortices
+  */
+void freeRadii(double *vortexRadii, double *tracerRadii) {
+    if (vortexRadii) munmap(vortexRadii, sizeof(double) * vortexRadiiLength(tracerRadiiStride));
+    if (tracerRadii) munmap(tracerRadii, sizeof(double) * tracerRadiiStride * NUM_TRACERS * 3);
+}
+
+/**
+  make sure the radii arrays have room for a number of vortices. The arrays are reserved up front for the whole capacity, and the tracer
+  radii rows are spaced out for it, so nothing has to move until the capacity runs out. When it does, the arrays are moved to a bigger
+  reservation, which is the only time the radii are copied.
+
+  @param vortexRadii the vortex radii array
+  @param tracerRadii the tracer radii array
+  @param capacity the number of vortices to make room for. Must be at least numDriverVorts
+  */
+void resizeRadii(double **vortexRadii, double **tracerRadii, int capacity) {
+    if (capacity <= tracerRadiiStride) return;
+
+    double *newVortexRadii = reserveRadii(vortexRadiiLength(capacity));
+    double *newTracerRadii = reserveRadii((long)capacity * NUM_TRACERS * 3);
+    if (newVortexRadii == NULL && vortexRadiiLength(capacity)) {
+        printf("Error reserving vortex radii array");
+        exit(1);
+    } else if (newTracerRadii == NULL && NUM_TRACERS) {
+        printf("Error reserving tracer radii array");
+        exit(1);
+    }
+
+    if (tracerRadiiStride > 0) {
+        printf("Moving the radii arrays to make room for %i vortices. Set VORTEX_CAPACITY to avoid this\n", capacity);
+        memcpy(newVortexRadii, *vortexRadii, sizeof(double) * calculateVortexRadiiIndex(numDriverVorts, 0));
+        for (int tracerIndex = 0; tracerIndex < NUM_TRACERS; tracerIndex++) {
+            memcpy(&newTracerRadii[(long)tracerIndex * capacity * 3], &(*tracerRadii)[calculateTracerRadiiIndex(tracerIndex, 0)],
+                    sizeof(double) * 3 * numDriverVorts);
+        }
+    }
+    freeRadii(*vortexRadii, *tracerRadii);
+    *vortexRadii = newVortexRadii;
+    *tracerRadii = newTracerRadii;
+
+    dirtyRadii.isDirty = countedRealloc(dirtyRadii.isDirty, sizeof(char) * capacity);
+    if (dirtyRadii.isDirty == NULL) {
+        printf("Error reallocating dirty radii flags");
+        exit(1);
+    }
+    memset(&dirtyRadii.isDirty[tracerRadiiStride], 0, sizeof(char) * (capacity - tracerRadiiStride));
+
+    tracerRadiiStride = capacity;
+}
+
+/**
+  allocate the tracer arrays. Like the vortex arrays, they are carved out of one block, starting at x. Velocities start at zero.
+  */
+void allocateTracers(struct Tracers *tracers, int numTracers) {
+    if (numTracers == 0) return;
+
+    // the number of tracers never changes, so reallocating the block keeps every tracer where it was
+    char *block = realloc(tracers->x, (sizeof(double) * 4 + sizeof(int)) * numTracers);
+    if (block == NULL) {
+        printf("Error allocating tracer array");
+        exit(1);
+    }
+    tracers->x = (double *)block;
+    tracers->y = tracers->x + numTracers;
+    tracers->u = tracers->y + numTracers;
+    tracers->v = tracers->u + numTracers;
+    tracers->id = (int *)(tracers->v + numTracers);
+
+    memset(tracers->u, 0, sizeof(double) * numTracers);
+    memset(tracers->v, 0, sizeof(double) * numTracers);
+}
+
+/**
+  free the tracer arrays, which all live in the block starting at x
+  */
+void freeTracers(struct Tracers *tracers) {
+    free(tracers->x);
+    memset(tracers, 0, sizeof(struct Tracers));
+}
+
+/**
+  make sure the workspace has room for a timestep with a number of vortices and tracers. The buffers grow by half again when they run out,
+  and never shrink, so once the population settles down a timestep doesn't allocate anything.
+
+  @param work the workspace
+  @param numVorts the number of vortices in the timestep
+  @param numTracers the number of tracers in the timestep
+  */
+void reserveWorkspace(struct Workspace *work, int numVorts, int numTracers) {
+    if (numVorts > work->vortsAllocated) {
+        work->vortsAllocated = numVorts * 1.5;
+        work->positionCache = countedRealloc(work->positionCache, sizeof(struct RKPositions) * work->vortsAllocated);
+        work->kX = countedRealloc(work->kX, sizeof(double) * work->vortsAllocated);
+        work->kY = countedRealloc(work->kY, sizeof(double) * work->vortsAllocated);
+        work->dX = countedRealloc(work->dX, sizeof(double) * work->vortsAllocated);
+        work->dY = countedRealloc(work->dY, sizeof(double) * work->vortsAllocated);
+        work->stageX = countedRealloc(work->stageX, sizeof(double) * work->vortsAllocated);
+        work->stageY = countedRealloc(work->stageY, sizeof(double) * work->vortsAllocated);
+        if (work->positionCache == NULL || work->kX == NULL || work->kY == NULL || work->dX == NULL || work->dY == NULL
+                || work->stageX == NULL || work->stageY == NULL) {
+            printf("Error reallocating the vortex workspace");
+            exit(1);
+        }
+    }
+    if (numTracers > work->tracersAllocated) {
+        work->tracersAllocated = numTracers;
+        work->tracerKX = countedRealloc(work->tracerKX, sizeof(double) * numTracers);
+        work->tracerKY = countedRealloc(work->tracerKY, sizeof(double) * numTracers);
+        work->tracerDX = countedRealloc(work->tracerDX, sizeof(double) * numTracers);
+        work->tracerDY = countedRealloc(work->tracerDY, sizeof(double) * numTracers);
+        work->tracerStageX = countedRealloc(work->tracerStageX, sizeof(double) * numTracers);
+        work->tracerStageY = countedRealloc(work->tracerStageY, sizeof(double) * numTracers);
+        if (work->tracerKX == NULL || work->tracerKY == NULL || work->tracerDX == NULL || work->tracerDY == NULL
+                || work->tracerStageX == NULL || work->tracerStageY == NULL) {
+            printf("Error reallocating the tracer workspace");
+            exit(1);
+        }
+    }
+
+    // the intermediate radii have the same layout as the radii arrays, so they follow the radii arrays' capacity
+    if (useRadiiArrays() && work->radiiAllocated < tracerRadiiStride) {
+        if (work->intermediateRadii) munmap(work->intermediateRadii, sizeof(double) * vortexRadiiLength(work->radiiAllocated));
+        if (work->intermediateTracerRads) munmap(work->intermediateTracerRads, sizeof(double) * work->radiiAllocated * NUM_TRACERS * 3);
+
+        work->radiiAllocated = tracerRadiiStride;
+        work->intermediateRadii = reserveRadii(vortexRadiiLength(tracerRadiiStride));
+        work->intermediateTracerRads = reserveRadii((long)tracerRadiiStride * NUM_TRACERS * 3);
+        if ((work->intermediateRadii == NULL && vortexRadiiLength(tracerRadiiStride)) || (work->intermediateTracerRads == NULL && NUM_TRACERS)) {
+            printf("Error reserving the intermediate radii");
+            exit(1);
+        }
+    }
+}
+
+void freeWorkspace(struct Workspace *work) {
+    free(work->positionCache);
+    free(work->kX);
+    free(work->kY);
+    free(work->dX);
+    free(work->dY);
+    free(work->stageX);
+    free(work->stageY);
+    free(work->tracerKX);
+    free(work->tracerKY);
+    free(work->tracerDX);
+    free(work->tracerDY);
+    free(work->tracerStageX);
+    free(work->tracerStageY);
+    if (work->intermediateRadii) munmap(work->intermediateRadii, sizeof(double) * vortexRadiiLength(work->radiiAllocated));
+    if (work->intermediateTracerRads) munmap(work->intermediateTracerRads, sizeof(double) * work->radiiAllocated * NUM_TRACERS * 3);
+    free(work->sortKeys);
+    free(work->sortOrder);
+    free(work->sortScratch);
+    free(work->tracerSchedule.order);
+    free(work->tracerSchedule.cost);
+    free(work->tracerSchedule.sorted);
+    freeQuadTree(&work->solver.tree);
+    freeFMM(&work->solver.fmm);
+    freeParticleMesh(&work->solver.mesh);
+    memset(work, 0, sizeof(struct Workspace));
 }
 
 #pragma mark - Math Functions
 
+/**
+  Recalculates a block of rows of the vortex radii array and a block of tracers in the tracer radii array, from the current positions.
+
+  @param vortexRadii a pointer to the beginning of the array of doubles representing the radii of the vortices
+  @param vortices the vortex arrays
+  @param firstRow the first row of the vortex radii triangle to recalculate. Row i holds the radii from vortex i to vortices 0 through i-1
+  @param lastRow one past the last row to recalculate
+  @param tracerRadii a pointer to the beginning of the array of doubles representing the radii between the tracers and vortices
+  @param tracers the tracer arrays
+  @param firstTracer the first tracer to recalculate
+  @param lastTracer one past the last tracer to recalculate
+  */
+void updateRadiiRange(double *vortexRadii, struct Vortices *vortices, int firstRow, int lastRow, double *tracerRadii, struct Tracers *tracers, int firstTracer, int lastTracer) {
+    long index;
+    const double *vortX = vortices->x;
+    const double *vortY = vortices->y;
+
+    for (int i = firstRow; i < lastRow; ++i) { // if this doesn't segfault it'll be a goddamn miracle
+        // row i of the triangle holds the radii to vortices 0 through i-1, in order
+        index = calculateVortexRadiiIndex(i, 0);
+        for (int j = 0; j < i; ++j, index += 3) {
+            vortexRadii[index+1] = vortX[i] - vortX[j];
+            vortexRadii[index+2] = vortY[i] - vortY[j];
+            vortexRadii[index] = sqrt(vortexRadii[index+1] * vortexRadii[index+1] + vortexRadii[index+2] * vortexRadii[index+2]);
+        }
+    }
+    for (int tracerIndex = firstTracer; tracerIndex < lastTracer; tracerIndex++) {
+        double tracerX = tracers->x[tracerIndex];
+        double tracerY = tracers->y[tracerIndex];
+        index = calculateTracerRadiiIndex(tracerIndex, 0);
+        for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++, index += 3) {
+            tracerRadii[index+1] = vortX[vortIndex] - tracerX;
+            tracerRadii[index+2] = vortY[vortIndex] - tracerY;
+            tracerRadii[index] = sqrt(tracerRadii[index+1] * tracerRadii[index+1] + tracerRadii[index+2] * tracerRadii[index+2]);
+        }
+    }
+}
+
 /**
   Recalculates all radii in a vortex radii array and a tracer radii array. Does so by calculating the pythagorean theorem for every radius. The radii arrays which are passed are modified.
 
   @param vortexRadii a pointer to the beginning of the array of doubles representing the radii of the vortices
-  @param vortices a pointer to the beginning of the array of pointers to Vortex structs
+  @param vortices the vortex arrays
   @param tracerRadii a pointer to the beginning of the array of doubles representing the radii between the tracers and vortices
-  @param tracers a pointer to the array of Tracer structs
+  @param tracers the tracer arrays
   @param numTracers the number of tracers which should be recalculated
   */
-void updateRadii_pythagorean(double *vortexRadii, struct Vortex *vortices, double *tracerRadii, struct Tracer *tracers, int numTracers) {
-    long index;
+void updateRadii_pythagorean(double *vortexRadii, struct Vortices *vortices, double *tracerRadii, struct Tracers *tracers, int numTracers) {
+    if (vortexRadii == NULL) return; // the radii arrays aren't in use
 
-    for (int i = 0; i < numDriverVorts; ++i) { // if this doesn't segfault it'll be a goddamn miracle
-        for (int j = 0; j < i; ++j) {
-            index = calculateVortexRadiiIndex(vortices[i].vIndex, vortices[j].vIndex);
+    updateRadiiRange(vortexRadii, vortices, 0, numDriverVorts, tracerRadii, tracers, 0, numTracers);
+
+    // nothing is out of date anymore
+    memset(dirtyRadii.isDirty, 0, sizeof(char) * numDriverVorts);
+    dirtyRadii.count = 0;
+}
+
+/**
+  mark the radii of a vortex as out of date, after it has been spawned or moved. They are recalculated by the next refreshDirtyRadii().
+  Does nothing if the radii arrays aren't in use.
+  */
+void markRadiiDirty(int vortIndex) {
+    if (dirtyRadii.isDirty == NULL || dirtyRadii.isDirty[vortIndex]) return;
 
-            vortexRadii[index+1] = vortices[i].position[0] - vortices[j].position[0];
-            vortexRadii[index+2] = vortices[i].position[1] - vortices[j].position[1];
-            vortexRadii[index] = sqrt(pow(vortexRadii[index+1], 2.) + pow(vortexRadii[index+2], 2.));
+    dirtyRadii.isDirty[vortIndex] = 1;
+    dirtyRadii.count++;
+}
+
+/**
+  Recalculates the radii between every dirty vortex and every other vortex and tracer, and nothing else. A radius between two dirty
+  vortices is only recalculated once, in the row of the later one.
+
+  @param vortexRadii the vortex radii array, or NULL if the radii arrays aren't in use
+  @param vortices the vortex arrays
+  @param tracerRadii the tracer radii array
+  @param tracers the tracer arrays
+  @param numTracers the number of tracers
+  */
+void refreshDirtyRadii(double *vortexRadii, struct Vortices *vortices, double *tracerRadii, struct Tracers *tracers, int numTracers) {
+    if (vortexRadii == NULL || dirtyRadii.count == 0) return;
+
+    const double *vortX = vortices->x;
+    const double *vortY = vortices->y;
+    char *isDirty = dirtyRadii.isDirty;
+
+    for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
+        if (!isDirty[vortIndex]) continue;
+
+        // the vortex's row of the triangle holds x_vortIndex - x_j, and every later row holds x_i - x_vortIndex in its column
+        long index = calculateVortexRadiiIndex(vortIndex, 0);
+        for (int j = 0; j < vortIndex; j++, index += 3) {
+            vortexRadii[index+1] = vortX[vortIndex] - vortX[j];
+            vortexRadii[index+2] = vortY[vortIndex] - vortY[j];
+            vortexRadii[index] = sqrt(vortexRadii[index+1] * vortexRadii[index+1] + vortexRadii[index+2] * vortexRadii[index+2]);
         }
-    }
-    index = 0;
-    for (int tracerIndex = 0; tracerIndex < numTracers; tracerIndex++) {
-        struct Tracer *tracer = &tracers[tracerIndex];
-        for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
-            struct Vortex *vort = &vortices[vortIndex];
+        dirtyRadii.refreshed += vortIndex;
+        for (int i = vortIndex + 1; i < numDriverVorts; i++) {
+            if (isDirty[i]) continue;
+
+            index = calculateVortexRadiiIndex(i, vortIndex);
+            vortexRadii[index+1] = vortX[i] - vortX[vortIndex];
+            vortexRadii[index+2] = vortY[i] - vortY[vortIndex];
+            vortexRadii[index] = sqrt(vortexRadii[index+1] * vortexRadii[index+1] + vortexRadii[index+2] * vortexRadii[index+2]);
+            dirtyRadii.refreshed++;
+        }
+        for (int tracerIndex = 0; tracerIndex < numTracers; tracerIndex++) {
             index = calculateTracerRadiiIndex(tracerIndex, vortIndex);
-
-            tracerRadii[index+1] = vort->position[0] - tracer->position[0];
-            tracerRadii[index+2] = vort->position[1] - tracer->position[1];
-            tracerRadii[index] = sqrt(pow(tracerRadii[index+1], 2.) + pow(tracerRadii[index+2], 2.));
+            tracerRadii[index+1] = vortX[vortIndex] - tracers->x[tracerIndex];
+            tracerRadii[index+2] = vortY[vortIndex] - tracers->y[tracerIndex];
+            tracerRadii[index] = sqrt(tracerRadii[index+1] * tracerRadii[index+1] + tracerRadii[index+2] * tracerRadii[index+2]);
         }
+        dirtyRadii.refreshed += numTracers;
     }
+
+    memset(isDirty, 0, sizeof(char) * numDriverVorts);
+    dirtyRadii.count = 0;
 }
 
 /**
-  Calculate the strength of the interaction of one body on a second body as a function of the distance between the current body and the 2nd one.
+  find the distance between two vortices. This is read from the radii array if it is in use, and computed from the positions if it isn't
 
-  @param vortex2Intensity The intensity of the other vortex
-  @param radius The radial distance to the other vortex
-  @return the magnitude of the velocity vector resulting from the interaction of the other vortex on the current vortex
+  @param vortexRadii the vortex radii array, or NULL
+  @param vortices the vortex arrays
+  @param vortIndex1 the index of one of the vortices
+  @param vortIndex2 the index of the other vortex
   */
-double velocityFunc(double vortex2Intensity, double radius) {
-    return vortex2Intensity/(2.*M_PI*radius);
-    // return vortex2Intensity/radius;
+double vortexSeparation(double *vortexRadii, struct Vortices *vortices, int vortIndex1, int vortIndex2) {
+    if (vortexRadii != NULL) return vortexRadii[calculateVortexRadiiIndex(vortIndex1, vortIndex2)];
+
+    double xRad = vortices->x[vortIndex1] - vortices->x[vortIndex2];
+    double yRad = vortices->y[vortIndex1] - vortices->y[vortIndex2];
+    return sqrt(xRad * xRad + yRad * yRad);
+}
+
+/**move every coordinate in an array which is outside of [0, size] back into it*/
+void wrapCoordinates(double *coords, int n, double size) {
+    for (int i = 0; i < n; i++) {
+        if (coords[i] < 0) {
+            coords[i] = size + fmod(coords[i], size);
+        } else if (coords[i] > size) {
+            coords[i] = fmod(coords[i], size);
+        }
+    }
 }
 
 #pragma mark - RK4 Functions
@@ -127,78 +482,50 @@ const char domains = 8; // 0 to disable wrapping of forces, 8 to enable it.
   Calculate the x and y components of the velocity of a vortex based on the strengths of the other vortices, and the distance data in the intRads array
   @param xVel Pointer to a double which will be updated to reflect the new x-velocity of the vortex
   @param yVel Pointer to a double which will be updated to reflect the new y-velocity of the vortex
-  @param vort Pointer to the vortex to compute velocities for
-  @param vortices Pointer to an array of all of the vortices in the system
+  @param vortIndex index of the vortex to compute velocities for
+  @param vortices the vortex arrays
   @param rads The array containing all of the distance information between vortices as doubles
   @param numRads The length of the rads array
   */
-void calculateVel_vortex(double *xVel, double *yVel, struct Vortex *vort, struct Vortex *vortices, double *rads, long numRads) {
-    for (int j = 0; j < numDriverVorts; ++j) {
-        if (vort->vIndex == j) {
-            continue;
-        }
-
-        long radiiIndex = calculateVortexRadiiIndex(vort->vIndex, vortices[j].vIndex);
-
-        for (int domain = 0; domain <= domains; domain++) {
-            double rad;
-            double xRad = (vort->vIndex < vortices[j].vIndex) ? rads[radiiIndex + 1] : -rads[radiiIndex + 1];
-            double yRad = (vort->vIndex < vortices[j].vIndex) ? rads[radiiIndex + 2] : -rads[radiiIndex + 2];
-
-            if (domain) {
-                /* domain numbering scheme:
-                   1 2 3
-                   4 0 5
-                   6 7 8
-                   */
-
-                switch (domain) {
-                    case 1: {
-                                xRad -= DOMAIN_SIZE_X;
-                                yRad += DOMAIN_SIZE_Y;
-                                break;
-                            } case 2: {
-                                yRad += DOMAIN_SIZE_Y;
-                                break;
-                            } case 3: {
-                                xRad += DOMAIN_SIZE_X;
-                                yRad += DOMAIN_SIZE_Y;
-                                break;
-                            } case 4: {
-                                xRad -= DOMAIN_SIZE_X;
-                                break;
-                            } case 5: {
-                                xRad += DOMAIN_SIZE_X;
-                                break;
-                            } case 6: {
-                                xRad -= DOMAIN_SIZE_X;
-                                yRad -= DOMAIN_SIZE_Y;
-                                break;
-                            } case 7: {
-                                yRad -= DOMAIN_SIZE_Y;
-                                break;
-                            } case 8: {
-                                xRad += DOMAIN_SIZE_X;
-                                yRad -= DOMAIN_SIZE_Y;
-                                break;
-                            } default: {
-                                break;
-                            }
-                }
-                rad = sqrt(pow(xRad, 2) + pow(yRad, 2));
-            } else {
-                rad = rads[radiiIndex];
-            }
-
-            if (rad > DOMAIN_SIZE_X) {
-                continue; // domain truncation
+void calculateVel_vortex(double *xVel, double *yVel, int vortIndex, struct Vortices *vortices, double *rads, long numRads) {
+    if (PERIODIC_KERNEL) {
+        for (int j = 0; j < numDriverVorts; ++j) {
+            if (vortIndex == j) {
+                continue;
             }
 
-            double vmag = velocityFunc(vortices[j].intensity, rad); // total velocity magnitude
-            *xVel +=  (yRad/rad) * vmag;
-            *yVel += (-xRad/rad) * vmag;
+            long radiiIndex = calculateVortexRadiiIndex(vortIndex, j);
+            double xRad = (vortIndex < j) ? rads[radiiIndex + 1] : -rads[radiiIndex + 1];
+            double yRad = (vortIndex < j) ? rads[radiiIndex + 2] : -rads[radiiIndex + 2];
+            periodicKernelVelocity(xRad, yRad, vortices->gamma[j], xVel, yVel);
         }
+        return;
+    }
+
+    int count = numDriverVorts - 1;
+    if (count <= 0) return;
+
+    // copy the radii to every other vortex into contiguous arrays so that the kernel can stream through them.
+    // the radii to the vortices before this one are in its row of the triangle, and the rest are in its column
+    double *workspace = biotSavartWorkspace(count);
+    double *xRad = workspace;
+    double *yRad = workspace + count;
+    double *gamma = workspace + 2 * count;
+
+    long radiiIndex = calculateVortexRadiiIndex(vortIndex, 0);
+    for (int j = 0; j < vortIndex; ++j, radiiIndex += 3) {
+        xRad[j] = -rads[radiiIndex + 1];
+        yRad[j] = -rads[radiiIndex + 2];
+        gamma[j] = vortices->gamma[j];
+    }
+    for (int j = vortIndex + 1; j < numDriverVorts; ++j) {
+        radiiIndex = calculateVortexRadiiIndex(vortIndex, j);
+        xRad[j - 1] = rads[radiiIndex + 1];
+        yRad[j - 1] = rads[radiiIndex + 2];
+        gamma[j - 1] = vortices->gamma[j];
     }
+
+    biotSavartVelocity(xRad, yRad, gamma, count, 0, 0, 0, xVel, yVel);
 }
 
 /**
@@ -208,520 +535,996 @@ void calculateVel_vortex(double *xVel, double *yVel, struct Vortex *vort, struct
   @param tracerIndex index of the tracer to compute velocities for
   @param rads The array containing all of the distance information between tracers and vortices as doubles
   @param numRads The length of the rads array
+  @param vortices the vortex arrays
+  @param singlePrecision true to sum the velocities in single precision, see TRACER_SINGLE_PRECISION
   */
-void calculateVel_tracer(double *xVel, double *yVel, long tracerIndex, double *rads, long numRads, struct Vortex *vortices) {
-    for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
-        long intRadIndex = calculateTracerRadiiIndex(tracerIndex, vortIndex);
-
-        for (int domain = 0; domain <= domains; domain++) {
-            double rad;
-            double xRad = rads[intRadIndex + 1], yRad = rads[intRadIndex + 2];
-
-
-            // if we're computing the effect of a vortex in the inner "driver" domain, then the radius data is already in memory. If
-            // the other vortex is in one of the outter domains, then we need to compute the radius data by adding/subtracting the
-            // domain size from its radius data, then compute the magnitude of the radius vector
-            if (domain) {
-                switch (domain) {
-                    case 1: {
-                        xRad -= DOMAIN_SIZE_X;
-                        yRad += DOMAIN_SIZE_Y;
-                        break;
-                    } case 2: {
-                        yRad += DOMAIN_SIZE_Y;
-                        break;
-                    } case 3: {
-                        xRad += DOMAIN_SIZE_X;
-                        yRad += DOMAIN_SIZE_Y;
-                        break;
-                    } case 4: {
-                        xRad -= DOMAIN_SIZE_X;
-                        break;
-                    } case 5: {
-                        xRad += DOMAIN_SIZE_X;
-                        break;
-                    } case 6: {
-                        xRad -= DOMAIN_SIZE_X;
-                        yRad -= DOMAIN_SIZE_Y;
-                        break;
-                    } case 7: {
-                        yRad -= DOMAIN_SIZE_Y;
-                        break;
-                    } case 8: {
-                        xRad += DOMAIN_SIZE_X;
-                        yRad -= DOMAIN_SIZE_Y;
-                        break;
-                    } default: {
-                        break;
-                    }
-                }
-                rad = sqrt(pow(xRad, 2) + pow(yRad, 2));
-            } else {
-                rad = rads[intRadIndex];
-            }
+void calculateVel_tracer(double *xVel, double *yVel, long tracerIndex, double *rads, long numRads, struct Vortices *vortices, char singlePrecision) {
+    const double *tracerRads = &rads[calculateTracerRadiiIndex(tracerIndex, 0)];
 
-            // domain truncation
-            if (rad > DOMAIN_SIZE_X || (TEST_CASE == 6 && rad < .1)) {
-                continue;
-            }
+    if (PERIODIC_KERNEL) {
+        for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
+            if (TEST_CASE == 6 && tracerRads[vortIndex * 3] < .1) continue;
+            periodicKernelVelocity(tracerRads[vortIndex * 3 + 1], tracerRads[vortIndex * 3 + 2], vortices->gamma[vortIndex], xVel, yVel);
+        }
+        return;
+    }
+
+    if (numDriverVorts == 0) return;
 
-            double vmag = velocityFunc(vortices[vortIndex].intensity, rad);
-            *xVel +=  (yRad/rad) * vmag;
-            *yVel += (-xRad/rad) * vmag;
+    if (singlePrecision) {
+        float *packed = biotSavartSingleWorkspace(numDriverVorts);
+        float *xRad = packed;
+        float *yRad = packed + numDriverVorts;
+        float *gamma = packed + 2 * numDriverVorts;
+        for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
+            xRad[vortIndex] = tracerRads[vortIndex * 3 + 1];
+            yRad[vortIndex] = tracerRads[vortIndex * 3 + 2];
+            gamma[vortIndex] = vortices->gamma[vortIndex];
         }
+
+        float minRadSquared = (TEST_CASE == 6) ? .1f * .1f : 0;
+        biotSavartVelocitySingle(xRad, yRad, gamma, numDriverVorts, 0, 0, minRadSquared, xVel, yVel);
+        return;
+    }
+
+    double *workspace = biotSavartWorkspace(numDriverVorts);
+    double *xRad = workspace;
+    double *yRad = workspace + numDriverVorts;
+    for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
+        xRad[vortIndex] = tracerRads[vortIndex * 3 + 1];
+        yRad[vortIndex] = tracerRads[vortIndex * 3 + 2];
     }
+
+    // test case 6 leaves out the vortices right next to the tracer
+    double minRadSquared = (TEST_CASE == 6) ? .1 * .1 : 0;
+    biotSavartVelocity(xRad, yRad, vortices->gamma, numDriverVorts, 0, 0, minRadSquared, xVel, yVel);
 }
 
-void stepForwardTracerRK4(void *arguments) {
-    struct TracerArgs *args = arguments;
-    int RKStep = args->RKStep;
-    struct Tracer *tracers = args->tracers;
-    int numTracers = args->numTracers;
-    double *tracerRadii = args->tracerRadii;
-    double *intermediateTracerRads = args->intermediateTracerRads;
-    struct Vortex *vortices = args->vortices;
+const double RKStageFractions[4] = {0, .5, .5, 1}; // how far into the timestep each RK stage evaluates velocities
+const double RKStageWeights[4] = {1, 2, 2, 1};
+const int velocityGrain = 8; // particles per task when the velocities of a stage are split up across the team
 
-    for (int tracerIndex = 0; tracerIndex < numTracers; ++tracerIndex) {
-        double k1_x = 0, k2_x = 0, k3_x = 0, k4_x = 0;
-        double k1_y = 0, k2_y = 0, k3_y = 0, k4_y = 0;
+struct Workspace workspace;
 
-        struct Tracer *tracer = &tracers[tracerIndex];
-        double xVel = 0;
-        double yVel = 0;
+const double *sortingCosts; // the costs compareChunkCosts() sorts by
 
-        long offsetTracerIndex = tracer->tIndex - tracers[0].tIndex;
-        calculateVel_tracer(&xVel,
-                &yVel,
-                offsetTracerIndex,
-                intermediateTracerRads,
-                (numDriverVorts * numTracers),
-                vortices);
-
-        switch (RKStep) {
-            case 1: {
-                        k1_x += xVel;
-                        k1_y += yVel;
-
-                        xVel = xVel/2;
-                        yVel = yVel/2;
-                        break;
-                    }
-            case 2: {
-                        k2_x += xVel;
-                        k2_y += yVel;
+/**qsort comparator which puts the most expensive chunks first, breaking ties by chunk index*/
+int compareChunkCosts(const void *a, const void *b) {
+    int chunkA = *(const int *)a;
+    int chunkB = *(const int *)b;
+    if (sortingCosts[chunkA] != sortingCosts[chunkB]) return (sortingCosts[chunkA] < sortingCosts[chunkB]) ? 1 : -1;
+    return chunkA - chunkB;
+}
 
-                        xVel = xVel/2;
-                        yVel = yVel/2;
-                        break;
-                    }
-            case 3: {
-                        k3_x += xVel;
-                        k3_y += yVel;
+/**@return the cell of the tracer cost grid a point is in*/
+int costGridCell(double x, double y) {
+    int cellX = (int)(x / DOMAIN_SIZE_X * TRACER_COST_GRID);
+    int cellY = (int)(y / DOMAIN_SIZE_Y * TRACER_COST_GRID);
+    cellX = (cellX % TRACER_COST_GRID + TRACER_COST_GRID) % TRACER_COST_GRID;
+    cellY = (cellY % TRACER_COST_GRID + TRACER_COST_GRID) % TRACER_COST_GRID;
+    return cellY * TRACER_COST_GRID + cellX;
+}
 
-                        break;
-                    }
-            case 4: {
-                        k4_x += xVel;
-                        k4_y += yVel;
-                        break;
-                    }
-            default: {
-                         break;
-                     }
-        }
-#ifdef DEBUG
+/**
+  Estimate the cost of every chunk of tracers, and deal the chunks out to the members of the team so that each one starts out with about
+  the same amount of work. Whatever the estimate gets wrong is evened out by work stealing.
 
-        switch (RKStep) {
-            case 1: {
-                        printf("step: %i | tracer: %i | k1_x: %1.15f\n", currentTimestep, tracer->tIndex, k1_x);
-                        printf("step: %i | tracer: %i | k1_y: %1.15f\n", currentTimestep, tracer->tIndex, k1_y);
-                        break;
-                    }
-            case 2: {
-                        printf("step: %i | tracer: %i | k2_x: %1.15f\n", currentTimestep, tracer->tIndex, k2_x);
-                        printf("step: %i | tracer: %i | k2_y: %1.15f\n", currentTimestep, tracer->tIndex, k2_y);
-                        break;
-                    }
-            case 3: {
-                        printf("step: %i | tracer: %i | k3_x: %1.15f\n", currentTimestep, tracer->tIndex, k3_x);
-                        printf("step: %i | tracer: %i | k3_y: %1.15f\n", currentTimestep, tracer->tIndex, k3_y);
-                        break;
-                    }
-            case 4: {
-                        printf("step: %i | tracer: %i | k4_x: %1.15f\n", currentTimestep, tracer->tIndex, k4_x);
-                        printf("step: %i | tracer: %i | k4_y: %1.15f\n", currentTimestep, tracer->tIndex, k4_y);
-                        break;
+  The tree, FMM and P3M solvers sum the vortices near a tracer directly and approximate the rest, so a tracer costs more the more vortices
+  there are around it. This is estimated from the number of vortices in the 3x3 cells of a coarse grid around the tracer. The direct solver
+  sums over every vortex for every tracer, so every tracer costs the same.
+
+  @param schedule the schedule to (re)build
+  @param vortices the vortex arrays
+  @param tracers the tracer arrays
+  @param numTracers the number of tracers
+  */
+void planTracerChunks(struct TracerSchedule *schedule, struct Vortices *vortices, struct Tracers *tracers, int numTracers) {
+    int numChunks = (numTracers + TRACER_CHUNK_SIZE - 1) / TRACER_CHUNK_SIZE;
+    if (numChunks > schedule->chunksAllocated) {
+        schedule->chunksAllocated = numChunks;
+        schedule->order = countedRealloc(schedule->order, sizeof(int) * numChunks);
+        schedule->cost = countedRealloc(schedule->cost, sizeof(double) * numChunks);
+        schedule->sorted = countedRealloc(schedule->sorted, sizeof(int) * numChunks);
+        if (schedule->order == NULL || schedule->cost == NULL || schedule->sorted == NULL) {
+            printf("Error reallocating tracer schedule");
+            exit(1);
+        }
+    }
+    schedule->numChunks = numChunks;
+
+    int density[TRACER_COST_GRID * TRACER_COST_GRID] = {0}; // vortices in the 3x3 cells around each cell
+    if (VELOCITY_SOLVER != SOLVER_DIRECT) {
+        int counts[TRACER_COST_GRID * TRACER_COST_GRID] = {0};
+        for (int i = 0; i < numDriverVorts; i++) counts[costGridCell(vortices->x[i], vortices->y[i])]++;
+
+        for (int cellY = 0; cellY < TRACER_COST_GRID; cellY++) {
+            for (int cellX = 0; cellX < TRACER_COST_GRID; cellX++) {
+                int sum = 0;
+                for (int offsetY = -1; offsetY <= 1; offsetY++) {
+                    for (int offsetX = -1; offsetX <= 1; offsetX++) {
+                        int neighborX = (cellX + offsetX + TRACER_COST_GRID) % TRACER_COST_GRID;
+                        int neighborY = (cellY + offsetY + TRACER_COST_GRID) % TRACER_COST_GRID;
+                        sum += counts[neighborY * TRACER_COST_GRID + neighborX];
                     }
-            default: {
-                         break;
-                     }
+                }
+                density[cellY * TRACER_COST_GRID + cellX] = sum;
+            }
         }
-#endif
+    }
 
-        for (int vortexIndex = 0; vortexIndex < numDriverVorts; ++vortexIndex) {
-            long radIndex = calculateTracerRadiiIndex(offsetTracerIndex, vortexIndex);
-            intermediateTracerRads[radIndex + 1] = tracerRadii[radIndex + 1] - xVel * timestep;
-            intermediateTracerRads[radIndex + 2] = tracerRadii[radIndex + 2] - yVel * timestep;
+    for (int chunk = 0; chunk < numChunks; chunk++) {
+        int last = (chunk + 1) * TRACER_CHUNK_SIZE;
+        if (last > numTracers) last = numTracers;
 
-            // pythagorean.
-            intermediateTracerRads[radIndex] = sqrt(pow(intermediateTracerRads[radIndex+1], 2) + pow(intermediateTracerRads[radIndex+2], 2));
+        double cost = 0;
+        for (int i = chunk * TRACER_CHUNK_SIZE; i < last; i++) cost += 1 + density[costGridCell(tracers->x[i], tracers->y[i])];
+        schedule->cost[chunk] = cost;
+        schedule->sorted[chunk] = chunk;
+    }
+    sortingCosts = schedule->cost;
+    qsort(schedule->sorted, numChunks, sizeof(int), compareChunkCosts);
+
+    // deal the chunks out from most to least expensive, each to whichever member has the least work so far and room left in its block
+    int size = teamSize();
+    int nextSlot[size], lastSlot[size];
+    double load[size];
+    for (int rank = 0; rank < size; rank++) {
+        teamBlock(numChunks, rank, 0, &nextSlot[rank], &lastSlot[rank]);
+        load[rank] = 0;
+    }
+    for (int i = 0; i < numChunks; i++) {
+        int chunk = schedule->sorted[i];
+        int best = -1;
+        for (int rank = 0; rank < size; rank++) {
+            if (nextSlot[rank] < lastSlot[rank] && (best < 0 || load[rank] < load[best])) best = rank;
         }
+        schedule->order[nextSlot[best]++] = chunk;
+        load[best] += schedule->cost[chunk];
+    }
+}
+
+/**
+  find the tracers in the chunk at one slot of a schedule
+
+  @param first set to the first tracer in the chunk
+  @param last set to one past the last tracer in the chunk
+  */
+void scheduledTracerChunk(struct TracerSchedule *schedule, int slot, int numTracers, int *first, int *last) {
+    *first = schedule->order[slot] * TRACER_CHUNK_SIZE;
+    *last = *first + TRACER_CHUNK_SIZE;
+    if (*last > numTracers) *last = numTracers;
+}
+
+/**
+  parallelFor() body which calculates the velocities of vortices [first, last) at one stage of the radii integrator
+  */
+void radiiStageVortexVelocities(int first, int last, void *context) {
+    struct StageVelocities *work = context;
+    struct StepContext *step = work->step;
+
+    // the first stage uses the radii at the start of the step, and every later stage is rebuilt from them
+    double *stageVortexRadii = (work->stage == 0) ? step->vortexRadii : step->intermediateRadii;
+
+    for (int vortIndex = first; vortIndex < last; vortIndex++) {
+        double xVel = 0;
+        double yVel = 0;
+        calculateVel_vortex(&xVel, &yVel, vortIndex, step->vortices, stageVortexRadii, step->vortRadLen);
+        step->kX[vortIndex] = xVel;
+        step->kY[vortIndex] = yVel;
+#ifdef DEBUG
+        printf("step: %i | vortex: %i | k%i_x: %1.15f\n", currentTimestep, vortIndex, work->stage + 1, xVel);
+        printf("step: %i | vortex: %i | k%i_y: %1.15f\n", currentTimestep, vortIndex, work->stage + 1, yVel);
+#endif
+    }
+}
 
-        tracer->velocity[0] += (k1_x + k2_x * 2. + k3_x * 2. + k4_x)/6.;
-        tracer->velocity[1] += (k1_y + k2_y * 2. + k3_y * 2. + k4_y)/6.;
+/**
+  parallelFor() body which calculates the velocities of the tracer chunks at slots [firstSlot, lastSlot) of the tracer schedule, at one
+  stage of the radii integrator
+  */
+void radiiStageTracerVelocities(int firstSlot, int lastSlot, void *context) {
+    struct StageVelocities *work = context;
+    struct StepContext *step = work->step;
+    double *stageTracerRadii = (work->stage == 0) ? step->tracerRadii : step->intermediateTracerRads;
+
+    for (int slot = firstSlot; slot < lastSlot; slot++) {
+        int firstTracer, lastTracer;
+        scheduledTracerChunk(step->tracerSchedule, slot, step->numTracers, &firstTracer, &lastTracer);
+
+        for (int tracer = firstTracer; tracer < lastTracer; tracer++) {
+            double xVel = 0;
+            double yVel = 0;
+            calculateVel_tracer(&xVel, &yVel, tracer, stageTracerRadii, (long)tracerRadiiStride * step->numTracers, step->vortices, TRACER_SINGLE_PRECISION);
+            step->tracerKX[tracer] = xVel;
+            step->tracerKY[tracer] = yVel;
+#ifdef DEBUG
+            printf("step: %i | tracer: %i | k%i_x: %1.15f\n", currentTimestep, step->tracers->id[tracer], work->stage + 1, xVel);
+            printf("step: %i | tracer: %i | k%i_y: %1.15f\n", currentTimestep, step->tracers->id[tracer], work->stage + 1, yVel);
+#endif
+        }
     }
+}
 
-    free(arguments);
+/**
+  add the velocities of one RK stage to the velocities of a block of vortices and tracers, and save the stage positions of the vortices
+  if SAVE_RK_STEPS is set
+  */
+void accumulateStage(struct StepContext *step, int stage, int firstVort, int lastVort, int firstTracer, int lastTracer) {
+    struct Vortices *vortices = step->vortices;
+    struct Tracers *tracers = step->tracers;
+
+    for (int i = firstVort; i < lastVort; i++) {
+        vortices->u[i] += step->kX[i] * RKStageWeights[stage] / 6.;
+        vortices->v[i] += step->kY[i] * RKStageWeights[stage] / 6.;
+
+        if (SAVE_RK_STEPS) {
+            struct Vector pos;
+            pos.x = vortices->x[i] + step->kX[i] * timestep;
+            pos.y = vortices->y[i] + step->kY[i] * timestep;
+
+            step->positionCache[i].vID = vortices->id[i];
+            switch (stage) {
+                case 0: step->positionCache[i].step1Pos = pos; break;
+                case 1: step->positionCache[i].step2Pos = pos; break;
+                case 2: step->positionCache[i].step3Pos = pos; break;
+                default: step->positionCache[i].step4Pos = pos; break;
+            }
+        }
+    }
+    for (int i = firstTracer; i < lastTracer; i++) {
+        tracers->u[i] += step->tracerKX[i] * RKStageWeights[stage] / 6.;
+        tracers->v[i] += step->tracerKY[i] * RKStageWeights[stage] / 6.;
+    }
 }
 
-struct RKPositions *intPositionCache;
-void stepForwardVortexRK4(void *arguments) {
-    struct VortexArgs *args = arguments;
-    struct Vortex *vortices = args->vortices;
-    int originVortIndex = args->originVortIndex;
-    double *intermediateRadii = args->intermediateRadii;
-    double *workingRadii = args->workingRadii;
-    long vortRadLen = args->vortRadLen;
-    int RKStep = args->RKStep;
-    double *intermediateTracerRads = args->intermediateTracerRads;
-    int numTracers = args->numTracers;
+/**
+  move a block of vortices and tracers to their positions at the end of the timestep, and wrap them back into the driver domain
+  */
+void finishStep(struct StepContext *step, int firstVort, int lastVort, int firstTracer, int lastTracer) {
+    struct Vortices *vortices = step->vortices;
+    struct Tracers *tracers = step->tracers;
 
-    double k1_x = 0, k2_x = 0, k3_x = 0, k4_x = 0;
-    double k1_y = 0, k2_y = 0, k3_y = 0, k4_y = 0;
+    for (int i = firstVort; i < lastVort; ++i) {
+        vortices->x[i] += vortices->u[i] * timestep;
+        vortices->y[i] += vortices->v[i] * timestep;
+    }
+    for (int i = firstTracer; i < lastTracer; ++i) {
+        tracers->x[i] += tracers->u[i] * timestep;
+        tracers->y[i] += tracers->v[i] * timestep;
+    }
 
-    struct Vortex *vort = &vortices[originVortIndex];
-    int vortIndex = vort->vIndex;
+    wrapCoordinates(&vortices->x[firstVort], lastVort - firstVort, DOMAIN_SIZE_X);
+    wrapCoordinates(&vortices->y[firstVort], lastVort - firstVort, DOMAIN_SIZE_Y);
+    wrapCoordinates(&tracers->x[firstTracer], lastTracer - firstTracer, DOMAIN_SIZE_X);
+    wrapCoordinates(&tracers->y[firstTracer], lastTracer - firstTracer, DOMAIN_SIZE_Y);
+}
 
-    double xVel = 0;
-    double yVel = 0;
+/**
+  The timestep of the radii integrator, run by every member of the team. Each member owns a block of vortices, a block of tracers, and a
+  block of rows of the vortex radii triangle, and is the only thread which writes to them.
+
+  Every stage has two parts. First the velocities of every particle are calculated from the radii of the current stage, load balanced
+  across the team with parallelFor(), with the tracers in the chunks planned by planTracerChunks(). Then, once every displacement is
+  known, each member rebuilds its rows of the radii for the next stage from the radii at the start of the step. Each radius is always
+  computed in the same order, so the result is identical for any THREADCOUNT. After the last stage the particles are moved, wrapped
+  back into the domain, and the radii are refreshed from the new positions.
+  */
+void stepForward_RK4_region(int rank, void *context) {
+    struct StepContext *step = context;
+    struct Vortices *vortices = step->vortices;
+    int firstVort, lastVort, firstTracer, lastTracer, firstRow, lastRow;
+    teamBlock(numDriverVorts, rank, 0, &firstVort, &lastVort);
+    teamBlock(step->numTracers, rank, 0, &firstTracer, &lastTracer);
+    teamBlock(numDriverVorts, rank, 1, &firstRow, &lastRow);
+
+    for (int stage = 0; stage < 4; stage++) {
+        struct StageVelocities work = {step, stage};
+        parallelFor(0, numDriverVorts, velocityGrain, radiiStageVortexVelocities, &work);
+        parallelFor(0, step->tracerSchedule->numChunks, 1, radiiStageTracerVelocities, &work);
+        accumulateStage(step, stage, firstVort, lastVort, firstTracer, lastTracer);
+
+        if (stage == 3) break;
+
+        // move every particle from its start of step position with this stage's velocity, for the next stage
+        double stageTime = RKStageFractions[stage + 1] * timestep;
+        for (int i = firstVort; i < lastVort; i++) {
+            step->dX[i] = step->kX[i] * stageTime;
+            step->dY[i] = step->kY[i] * stageTime;
+        }
+        for (int i = firstTracer; i < lastTracer; i++) {
+            step->tracerDX[i] = step->tracerKX[i] * stageTime;
+            step->tracerDY[i] = step->tracerKY[i] * stageTime;
+        }
 
-    calculateVel_vortex(&xVel, &yVel, vort, vortices, intermediateRadii, vortRadLen);
+        teamBarrier(); // every displacement is known, and nobody is reading the stage radii anymore
 
-    switch (RKStep) {
-        case 1: {
-                    k1_x = xVel;
-                    k1_y = yVel;
+        // row i of the triangle holds x_i - x_j for every j < i, so it gets the displacement of vortex i, minus the displacement of vortex j
+        for (int i = firstRow; i < lastRow; i++) {
+            long index = calculateVortexRadiiIndex(i, 0);
+            for (int j = 0; j < i; j++, index += 3) {
+                double xRad = (step->vortexRadii[index + 1] + step->dX[i]) - step->dX[j];
+                double yRad = (step->vortexRadii[index + 2] + step->dY[i]) - step->dY[j];
 
-                    xVel = xVel/2.;
-                    yVel = yVel/2.;
-                    break;
-                }
-        case 2: {
-                    k2_x = xVel;
-                    k2_y = yVel;
+                step->intermediateRadii[index + 1] = xRad;
+                step->intermediateRadii[index + 2] = yRad;
+                step->intermediateRadii[index] = sqrt(xRad * xRad + yRad * yRad);
+            }
+        }
+        // the tracer radii hold vortex - tracer
+        for (int tracer = firstTracer; tracer < lastTracer; tracer++) {
+            long index = calculateTracerRadiiIndex(tracer, 0);
+            for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++, index += 3) {
+                double xRad = (step->tracerRadii[index + 1] - step->tracerDX[tracer]) + step->dX[vortIndex];
+                double yRad = (step->tracerRadii[index + 2] - step->tracerDY[tracer]) + step->dY[vortIndex];
+
+                step->intermediateTracerRads[index + 1] = xRad;
+                step->intermediateTracerRads[index + 2] = yRad;
+                step->intermediateTracerRads[index] = sqrt(xRad * xRad + yRad * yRad);
+            }
+        }
 
-                    xVel = xVel/2.;
-                    yVel = yVel/2.;
-                    break;
-                }
-        case 3: {
-                    k3_x = xVel;
-                    k3_y = yVel;
-                    break;
-                }
-        case 4: {
-                    k4_x = xVel;
-                    k4_y = yVel;
-                    break;
-                }
-        default: {
-                     break;
-                 }
+        teamBarrier(); // the radii for the next stage are ready
     }
 
-#ifdef DEBUG
-    switch (RKStep) {
-        case 1: {
-                    printf("step: %i | vortex: %i | k1_x: %1.15f\n", currentTimestep, vort->vIndex, k1_x);
-                    printf("step: %i | vortex: %i | k1_y: %1.15f\n", currentTimestep, vort->vIndex, k1_y);
-                    break;
-                }
-        case 2: {
-                    printf("step: %i | vortex: %i | k2_x: %1.15f\n", currentTimestep, vort->vIndex, k2_x);
-                    printf("step: %i | vortex: %i | k2_y: %1.15f\n", currentTimestep, vort->vIndex, k2_y);
-                    break;
-                }
-        case 3: {
-                    printf("step: %i | vortex: %i | k3_x: %1.15f\n", currentTimestep, vort->vIndex, k3_x);
-                    printf("step: %i | vortex: %i | k3_y: %1.15f\n", currentTimestep, vort->vIndex, k3_y);
-                    break;
-                }
-        case 4: {
-                    printf("step: %i | vortex: %i | k4_x: %1.15f\n", currentTimestep, vort->vIndex, k4_x);
-                    printf("step: %i | vortex: %i | k4_y: %1.15f\n", currentTimestep, vort->vIndex, k4_y);
-                    break;
-                }
-        default: {
-                     break;
-                 }
-    }
-#endif
+    finishStep(step, firstVort, lastVort, firstTracer, lastTracer);
+    teamBarrier(); // every particle is at its new position
 
-    for (int j = 0; j < numDriverVorts; ++j) {
-        if (originVortIndex == j) {
-            continue;
-        }
+    updateRadiiRange(step->vortexRadii, vortices, firstRow, lastRow, step->tracerRadii, step->tracers, firstTracer, lastTracer);
+}
 
-        //		bool __atomic_compare_exchange (type *ptr, type *expected, type *desired, bool weak, int success_memorder, int failure_memorder)
+/**
+  moves the simulation forward 1 timestep using runge-kutta 4th order. This function updates all vortex and tracer positions and velocities,
+  wraps the particles back into the driver domain, and refreshes the radii arrays. The whole timestep runs as one region on the team.
 
-        long radiiIndex = calculateVortexRadiiIndex(vortIndex, vortices[j].vIndex);
+  @param vortices The vortex arrays
+  @param vortRadii The array of doubles containing vortex <-> vortex distance information
+  @param tracerRadii The array of doubles containing vortex <-> tracer distance information
+  @param tracers The tracer arrays
+  @param numTracers The numebr of tracers
+  */
+void stepForward_RK4(struct Vortices *vortices, double *vortRadii, double *tracerRadii, struct Tracers *tracers, int numTracers) {
+    reserveWorkspace(&workspace, numDriverVorts, numTracers);
+
+    struct StepContext step = {0};
+    step.vortices = vortices;
+    step.tracers = tracers;
+    step.numTracers = numTracers;
+    step.tracerSchedule = &workspace.tracerSchedule;
+    step.positionCache = workspace.positionCache;
+    step.vortRadLen = ((long)numDriverVorts * numDriverVorts - numDriverVorts)/2;
+    step.vortexRadii = vortRadii;
+    step.tracerRadii = tracerRadii;
+    step.intermediateRadii = workspace.intermediateRadii;
+    step.intermediateTracerRads = workspace.intermediateTracerRads;
+    step.kX = workspace.kX;
+    step.kY = workspace.kY;
+    step.dX = workspace.dX;
+    step.dY = workspace.dY;
+    step.tracerKX = workspace.tracerKX;
+    step.tracerKY = workspace.tracerKY;
+    step.tracerDX = workspace.tracerDX;
+    step.tracerDY = workspace.tracerDY;
 
-        // if (vortIndex != vortices[j].otherVort) {
-        // vort->otherVort++;
-        // }
+    // zero out the velocities for all the vortices and tracers
+    memset(vortices->u, 0, sizeof(double) * numDriverVorts);
+    memset(vortices->v, 0, sizeof(double) * numDriverVorts);
+    memset(tracers->u, 0, sizeof(double) * numTracers);
+    memset(tracers->v, 0, sizeof(double) * numTracers);
 
-        // Whether we add or subtract d_dj from radii depends on which index is larger.
+    planTracerChunks(step.tracerSchedule, vortices, tracers, numTracers);
+    runTeamRegion(stepForward_RK4_region, &step);
 
-        char addVals = vort->vIndex > vortices[j].vIndex;
+    if (SAVE_RK_STEPS) saveIntermediateVortPositions(numDriverVorts, step.positionCache);
+}
 
-        double oldXRad, oldYRad, oldRadMag;
+/**
+  build the solver selected by VELOCITY_SOLVER over the stage positions of the vortices
 
-        __atomic_load(&workingRadii[radiiIndex + 1], &oldXRad, __ATOMIC_SEQ_CST);
-        double newXRad;
-        do {
-            newXRad = addVals ? oldXRad + xVel*timestep : oldXRad - xVel*timestep;
-        } while (!__atomic_compare_exchange(&workingRadii[radiiIndex + 1], &oldXRad, &newXRad, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+  @param solver the solver state to (re)build
+  @param x array of vortex x-positions
+  @param y array of vortex y-positions
+  @param intensities array of vortex intensities
+  @param numSources the length of the x, y and intensities arrays
+  */
+void buildVelocitySolver(struct VelocitySolver *solver, double *x, double *y, double *intensities, int numSources) {
+    if (VELOCITY_SOLVER == SOLVER_DIRECT) {
+        // nothing to build, the sources are summed over directly
+        solver->sourceX = x;
+        solver->sourceY = y;
+        solver->sourceGamma = intensities;
+        solver->numSources = numSources;
+    } else if (VELOCITY_SOLVER == SOLVER_FMM) {
+        buildFMM(&solver->fmm, x, y, intensities, numSources);
+    } else if (VELOCITY_SOLVER == SOLVER_PM) {
+        buildParticleMesh(&solver->mesh, x, y, intensities, numSources);
+    } else {
+        buildQuadTree(&solver->tree, x, y, intensities, numSources);
+    }
+}
 
-        __atomic_load(&workingRadii[radiiIndex + 2], &oldYRad, __ATOMIC_SEQ_CST);
-        double newYRad;
-        do {
-            newYRad = addVals ? oldYRad + xVel*timestep : oldYRad - xVel*timestep;
-        } while (!__atomic_compare_exchange(&workingRadii[radiiIndex + 2], &oldYRad, &newYRad, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+/**
+  Calculate the velocity at a point by summing over every source in the solver, computing the separations from the stage positions
+  rather than reading them from the radii arrays
+
+  @param xVel Pointer to a double which the x-velocity is added to
+  @param yVel Pointer to a double which the y-velocity is added to
+  @param solver a solver built over the stage positions of the vortices
+  @param x x-position of the target
+  @param y y-position of the target
+  @param selfIndex index of the target in the sources, or -1 if it is a tracer
+  */
+void calculateVel_direct(double *xVel, double *yVel, struct VelocitySolver *solver, double x, double y, int selfIndex) {
+    if (PERIODIC_KERNEL) {
+        for (int j = 0; j < solver->numSources; j++) {
+            if (j == selfIndex) continue;
+
+            double xRad = solver->sourceX[j] - x;
+            double yRad = solver->sourceY[j] - y;
+            if (TEST_CASE == 6 && selfIndex < 0 && xRad * xRad + yRad * yRad < .1 * .1) continue;
+            periodicKernelVelocity(xRad, yRad, solver->sourceGamma[j], xVel, yVel);
+        }
+        return;
+    }
 
-        __atomic_thread_fence(__ATOMIC_SEQ_CST); // not sure if this is neccessary
+    if (selfIndex < 0) {
+        // test case 6 leaves out the vortices right next to the tracer
+        double minRadSquared = (TEST_CASE == 6) ? .1 * .1 : 0;
+        biotSavartVelocity(solver->sourceX, solver->sourceY, solver->sourceGamma, solver->numSources, x, y, minRadSquared, xVel, yVel);
+    } else {
+        // the sources before and after the target, so that it doesn't interact with itself
+        biotSavartVelocity(solver->sourceX, solver->sourceY, solver->sourceGamma, selfIndex, x, y, 0, xVel, yVel);
+        int after = selfIndex + 1;
+        biotSavartVelocity(solver->sourceX + after, solver->sourceY + after, solver->sourceGamma + after, solver->numSources - after, x, y, 0, xVel, yVel);
+    }
+}
 
-        __atomic_load(&workingRadii[radiiIndex], &oldRadMag, __ATOMIC_SEQ_CST);
-        double newRadMag;
-        do {
-            __atomic_load(&workingRadii[radiiIndex + 1], &newXRad, __ATOMIC_SEQ_CST);
-            __atomic_load(&workingRadii[radiiIndex + 2], &newYRad, __ATOMIC_SEQ_CST);
-            newRadMag = sqrt(pow(newXRad, 2) + pow(newYRad, 2));
-        } while (!__atomic_compare_exchange(&workingRadii[radiiIndex], &oldRadMag, &newRadMag, 1, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+/**
+  Calculate the velocities of a block of targets using the velocity solver selected by VELOCITY_SOLVER
+
+  @param solver a solver built over the stage positions of the vortices
+  @param targetX array of target x-positions
+  @param targetY array of target y-positions
+  @param firstTarget the first target in the block
+  @param lastTarget one past the last target in the block
+  @param targetsAreSources true if the targets are the vortices the solver was built from, so that vortices don't interact with themselves
+  @param xVel array which the x-velocity of every target is written to
+  @param yVel array which the y-velocity of every target is written to
+  */
+void calculateStageVelocities(struct VelocitySolver *solver, double *targetX, double *targetY, int firstTarget, int lastTarget, char targetsAreSources, double *xVel, double *yVel) {
+    int selfIndex = -1;
+
+    for (int i = firstTarget; i < lastTarget; i++) {
+        double u = 0;
+        double v = 0;
+
+        if (targetsAreSources) selfIndex = i;
+        if (VELOCITY_SOLVER == SOLVER_DIRECT) {
+            calculateVel_direct(&u, &v, solver, targetX[i], targetY[i], selfIndex);
+        } else if (VELOCITY_SOLVER == SOLVER_FMM) {
+            fmmVelocity(&solver->fmm, targetX[i], targetY[i], selfIndex, &u, &v);
+        } else if (VELOCITY_SOLVER == SOLVER_PM) {
+            meshVelocity(&solver->mesh, targetX[i], targetY[i], selfIndex, &u, &v);
+        } else {
+            treeVelocity(&solver->tree, targetX[i], targetY[i], selfIndex, TREE_THETA, DOMAIN_SIZE_X, domains != 0, &u, &v);
+        }
 
+        xVel[i] = u;
+        yVel[i] = v;
     }
+}
 
-    for (int tracerI = 0; tracerI < numTracers; tracerI++) {
-        long index = calculateTracerRadiiIndex(tracerI, originVortIndex);
-        intermediateTracerRads[index + 1] += xVel*timestep;
-        intermediateTracerRads[index + 2] += yVel*timestep;
-        intermediateTracerRads[index] = sqrt(pow(intermediateTracerRads[index + 1], 2) + pow(intermediateTracerRads[index + 2], 2));
+/**
+  Calculate the velocities of a block of tracers by summing over every source of the direct solver in single precision, see
+  TRACER_SINGLE_PRECISION. Positions are too big to round to floats and then subtract, so the separations from each tracer are taken in
+  double and packed as floats, the same as calculateVel_tracer() packs the tracer radii.
+
+  @param solver the direct solver, built over the stage positions of the vortices
+  @param targetX array of tracer x-positions
+  @param targetY array of tracer y-positions
+  @param firstTarget the first tracer in the block
+  @param lastTarget one past the last tracer in the block
+  @param xVel array which the x-velocity of every tracer is written to
+  @param yVel array which the y-velocity of every tracer is written to
+  */
+void calculateTracerVelocitiesSingle(struct VelocitySolver *solver, double *targetX, double *targetY, int firstTarget, int lastTarget, double *xVel, double *yVel) {
+    int count = solver->numSources;
+    float *packed = biotSavartSingleWorkspace(count);
+    float *xRad = packed;
+    float *yRad = packed + count;
+    float *gamma = packed + 2 * count;
+    for (int j = 0; j < count; j++) gamma[j] = solver->sourceGamma[j];
+
+    // test case 6 leaves out the vortices right next to the tracer
+    float minRadSquared = (TEST_CASE == 6) ? .1f * .1f : 0;
+
+    for (int i = firstTarget; i < lastTarget; i++) {
+        for (int j = 0; j < count; j++) {
+            xRad[j] = solver->sourceX[j] - targetX[i];
+            yRad[j] = solver->sourceY[j] - targetY[i];
+        }
+
+        double u = 0;
+        double v = 0;
+        if (count > 0) biotSavartVelocitySingle(xRad, yRad, gamma, count, 0, 0, minRadSquared, &u, &v);
+        xVel[i] = u;
+        yVel[i] = v;
     }
+}
 
-    if (SAVE_RK_STEPS) {
-        struct Vector pos1;
-        pos1.x = vort->position[0] + k1_x * timestep;
-        pos1.y = vort->position[1] + k1_y * timestep;
+/**
+  parallelFor() body which calculates the velocities of vortices [first, last) at one stage of the positions integrator
+  */
+void solverStageVortexVelocities(int first, int last, void *context) {
+    struct StepContext *step = ((struct StageVelocities *)context)->step;
+    calculateStageVelocities(step->solver, step->stageX, step->stageY, first, last, 1, step->kX, step->kY);
+}
 
-        struct Vector pos2;
-        pos1.x = vort->position[0] + k2_x * timestep;
-        pos1.y = vort->position[1] + k2_y * timestep;
+/**
+  parallelFor() body which calculates the velocities of the tracer chunks at slots [firstSlot, lastSlot) of the tracer schedule, at one
+  stage of the positions integrator
+  */
+void solverStageTracerVelocities(int firstSlot, int lastSlot, void *context) {
+    struct StepContext *step = ((struct StageVelocities *)context)->step;
+
+    for (int slot = firstSlot; slot < lastSlot; slot++) {
+        int firstTracer, lastTracer;
+        scheduledTracerChunk(step->tracerSchedule, slot, step->numTracers, &firstTracer, &lastTracer);
+        if (TRACER_SINGLE_PRECISION) {
+            calculateTracerVelocitiesSingle(step->solver, step->tracerStageX, step->tracerStageY, firstTracer, lastTracer, step->tracerKX, step->tracerKY);
+        } else {
+            calculateStageVelocities(step->solver, step->tracerStageX, step->tracerStageY, firstTracer, lastTracer, 0, step->tracerKX, step->tracerKY);
+        }
+    }
+}
 
-        struct Vector pos3;
-        pos1.x = vort->position[0] + k3_x * timestep;
-        pos1.y = vort->position[1] + k3_y * timestep;
+/**
+  The timestep of the positions integrator, run by every member of the team. Each member owns a block of vortices and a block of tracers.
+  The solver is built by rank 0 once every stage position is known, and then the velocities are evaluated with parallelFor(), since the
+  cost of a tree or FMM evaluation depends on how clustered the vortices around each target are. The tracers are handed out in the
+  chunks planned by planTracerChunks().
+  */
+void stepForward_RK4_positions_region(int rank, void *context) {
+    struct StepContext *step = context;
+    struct Vortices *vortices = step->vortices;
+    struct Tracers *tracers = step->tracers;
+    int firstVort, lastVort, firstTracer, lastTracer;
+    teamBlock(numDriverVorts, rank, 0, &firstVort, &lastVort);
+    teamBlock(step->numTracers, rank, 0, &firstTracer, &lastTracer);
+
+    for (int stage = 0; stage < 4; stage++) {
+        double stageTime = RKStageFractions[stage] * timestep;
+
+        // each stage is evaluated at the start-of-step positions, moved by the previous stage's velocity
+        for (int i = firstVort; i < lastVort; i++) {
+            step->stageX[i] = vortices->x[i] + step->kX[i] * stageTime;
+            step->stageY[i] = vortices->y[i] + step->kY[i] * stageTime;
+        }
+        for (int i = firstTracer; i < lastTracer; i++) {
+            step->tracerStageX[i] = tracers->x[i] + step->tracerKX[i] * stageTime;
+            step->tracerStageY[i] = tracers->y[i] + step->tracerKY[i] * stageTime;
+        }
 
-        struct Vector pos4;
-        pos1.x = vort->position[0] + k4_x * timestep;
-        pos1.y = vort->position[1] + k4_y * timestep;
+        teamBarrier(); // every stage position is known
+        if (rank == 0) buildVelocitySolver(step->solver, step->stageX, step->stageY, vortices->gamma, numDriverVorts);
+        teamBarrier(); // the solver is ready
 
-        struct RKPositions positions;
-        positions.vort = vort;
-        positions.step1Pos = pos1;
-        positions.step2Pos = pos2;
-        positions.step3Pos = pos3;
-        positions.step4Pos = pos4;
+        struct StageVelocities work = {step, stage};
+        parallelFor(0, numDriverVorts, velocityGrain, solverStageVortexVelocities, &work);
+        parallelFor(0, step->tracerSchedule->numChunks, 1, solverStageTracerVelocities, &work);
+        accumulateStage(step, stage, firstVort, lastVort, firstTracer, lastTracer);
 
-        intPositionCache[vort->vIndex] = positions;
+        if (stage < 3) teamBarrier(); // nobody is using the solver or the stage positions anymore
     }
 
-    vort->velocity[0] += (k1_x + k2_x * 2 + k3_x * 2 + k4_x)/6;
-    vort->velocity[1] += (k1_y + k2_y * 2 + k3_y * 2 + k4_y)/6;
-    free(arguments);
+    finishStep(step, firstVort, lastVort, firstTracer, lastTracer);
 }
 
 /**
-  moves the simulation forward 1 timestep using runge-kutta 4th order. This function updates all vortex and tracer positions and velocities
-  @note This function does not update the appropriate radius arrays. Call @c UpdateRadii_Pythagorean() to update those arrays.
+  moves the simulation forward 1 timestep using runge-kutta 4th order, like @c stepForward_RK4(). Instead of updating the radii arrays
+  between stages, this keeps the stage position of every particle, and computes velocities from those with the solver selected by
+  VELOCITY_SOLVER. Only O(N + T) memory is used, and the radii arrays aren't needed. This is used for every solver except the
+  direct solver with RADII_FREE turned off.
 
   @param vortices The array of all of the vortices in the simulation
-  @param vortRadii The array of doubles containing vortex <-> vortex distance information
-  @param tracerRadii The array of doubles containing vortex <-> tracer distance information
-  @param numTracers The numebr of tracers
+  @param tracers The array of all of the tracers in the simulation
+  @param numTracers The number of tracers
   */
-void stepForward_RK4(struct Vortex *vortices, double *vortRadii, double *tracerRadii, struct Tracer *tracers, int numTracers) {
-    int sizeOfRadEntry = sizeof(double) * 3;
-    long vortRadLen = (pow(numDriverVorts, 2)-numDriverVorts)/2;
-    long vortRadSize = vortRadLen * sizeOfRadEntry;
-    intPositionCache = malloc(sizeof(struct RKPositions) * numDriverVorts);
-
-    /*
-       workingRadii is updated after every vortex is updated in position once per timestep, and should not be directly used to compute vortex velocities
-       intermediateRadii is updated after every runge-kutta step. At the end of the step, intermediateRadii is coppied into workingRadii
-       intermediateRadii should be used to compute the velocities of each particle.
-       */
+void stepForward_RK4_positions(struct Vortices *vortices, struct Tracers *tracers, int numTracers) {
+    reserveWorkspace(&workspace, numDriverVorts, numTracers);
+
+    struct StepContext step = {0};
+    step.vortices = vortices;
+    step.tracers = tracers;
+    step.numTracers = numTracers;
+    step.tracerSchedule = &workspace.tracerSchedule;
+    step.positionCache = workspace.positionCache;
+    step.solver = &workspace.solver;
+    step.stageX = workspace.stageX;
+    step.stageY = workspace.stageY;
+    step.kX = workspace.kX;
+    step.kY = workspace.kY;
+    step.tracerStageX = workspace.tracerStageX;
+    step.tracerStageY = workspace.tracerStageY;
+    step.tracerKX = workspace.tracerKX;
+    step.tracerKY = workspace.tracerKY;
+
+    // the first stage is evaluated at the start of step positions
+    memset(step.kX, 0, sizeof(double) * numDriverVorts);
+    memset(step.kY, 0, sizeof(double) * numDriverVorts);
+    memset(step.tracerKX, 0, sizeof(double) * numTracers);
+    memset(step.tracerKY, 0, sizeof(double) * numTracers);
+
+    memset(vortices->u, 0, sizeof(double) * numDriverVorts);
+    memset(vortices->v, 0, sizeof(double) * numDriverVorts);
+    memset(tracers->u, 0, sizeof(double) * numTracers);
+    memset(tracers->v, 0, sizeof(double) * numTracers);
+
+    planTracerChunks(step.tracerSchedule, vortices, tracers, numTracers);
+    runTeamRegion(stepForward_RK4_positions_region, &step);
+
+    if (SAVE_RK_STEPS) saveIntermediateVortPositions(numDriverVorts, step.positionCache);
+}
 
-    double *workingRadii = malloc(vortRadSize);
-    memcpy(workingRadii, vortRadii, vortRadSize);
-    pthread_mutex_t radMutex;
-    pthread_mutex_init(&radMutex, NULL);
-    double *intermediateRadii = malloc(vortRadSize);
-    memcpy(intermediateRadii, vortRadii, vortRadSize);
+/**
+  parallelFor() body which calculates the velocities of tracers [first, last) at their current positions both in single and double
+  precision, into tracerKX/tracerKY and tracerDX/tracerDY
+  */
+void precisionReportVelocities(int first, int last, void *context) {
+    struct StepContext *step = context;
 
-    long tracerRadLen = numDriverVorts * numTracers; // number of tracer radii entries in the array (each entry is 3 doubles: magnitude, xcomponent, ycomponent)
-    long tracerRadSize = tracerRadLen * sizeOfRadEntry; // length of the array in bytes
-    double *intermediateTracerRads = malloc(tracerRadSize);
-    memcpy(intermediateTracerRads, tracerRadii, tracerRadSize);
+    if (!useRadiiArrays()) {
+        calculateTracerVelocitiesSingle(step->solver, step->tracers->x, step->tracers->y, first, last, step->tracerKX, step->tracerKY);
+        calculateStageVelocities(step->solver, step->tracers->x, step->tracers->y, first, last, 0, step->tracerDX, step->tracerDY);
+        return;
+    }
 
-    // zero out the velocities for all the vortices and tracers
-    for (int i = 0; i < numDriverVorts; i++) {
-        struct Vortex *vort = &vortices[i];
-        vort->velocity[0] = 0;
-        vort->velocity[1] = 0;
+    long numRads = (long)tracerRadiiStride * step->numTracers;
+    for (int i = first; i < last; i++) {
+        double singleU = 0, singleV = 0, doubleU = 0, doubleV = 0;
+        calculateVel_tracer(&singleU, &singleV, i, step->tracerRadii, numRads, step->vortices, 1);
+        calculateVel_tracer(&doubleU, &doubleV, i, step->tracerRadii, numRads, step->vortices, 0);
+        step->tracerKX[i] = singleU;
+        step->tracerKY[i] = singleV;
+        step->tracerDX[i] = doubleU;
+        step->tracerDY[i] = doubleV;
     }
+}
 
+/**
+  Print how far the single precision tracer velocities are from a double precision shadow calculation at the current positions, for
+  TRACER_PRECISION_REPORT. The radii arrays have to be up to date. Uses the tracer buffers of the workspace, which the next timestep
+  overwrites anyway.
+
+  @param vortices the vortex arrays
+  @param tracerRadii the tracer radii array
+  @param tracers the tracer arrays
+  @param numTracers the number of tracers
+  */
+void reportTracerPrecision(struct Vortices *vortices, double *tracerRadii, struct Tracers *tracers, int numTracers) {
+    if (numTracers == 0) return;
+    reserveWorkspace(&workspace, numDriverVorts, numTracers);
+
+    struct StepContext step = {0};
+    step.vortices = vortices;
+    step.tracers = tracers;
+    step.numTracers = numTracers;
+    step.tracerRadii = tracerRadii;
+    step.solver = &workspace.solver;
+    step.tracerKX = workspace.tracerKX;
+    step.tracerKY = workspace.tracerKY;
+    step.tracerDX = workspace.tracerDX;
+    step.tracerDY = workspace.tracerDY;
+
+    if (!useRadiiArrays()) buildVelocitySolver(step.solver, vortices->x, vortices->y, vortices->gamma, numDriverVorts);
+    parallelFor(0, numTracers, TRACER_CHUNK_SIZE, precisionReportVelocities, &step);
+
+    double maxError = 0, squaredError = 0, squaredSpeed = 0;
     for (int i = 0; i < numTracers; i++) {
-        struct Tracer *tracer = &tracers[i];
-        tracer->velocity[0] = 0;
-        tracer->velocity[1] = 0;
+        double errorX = step.tracerKX[i] - step.tracerDX[i];
+        double errorY = step.tracerKY[i] - step.tracerDY[i];
+        double error = sqrt(errorX * errorX + errorY * errorY);
+        if (error > maxError) maxError = error;
+        squaredError += error * error;
+        squaredSpeed += step.tracerDX[i] * step.tracerDX[i] + step.tracerDY[i] * step.tracerDY[i];
     }
+    double rmsError = sqrt(squaredError / numTracers);
+    double rmsSpeed = sqrt(squaredSpeed / numTracers);
+    printf("Single precision tracer velocities: max error %e, rms error %e, relative rms error %e\n", maxError, rmsError,
+           (rmsSpeed > 0) ? rmsError / rmsSpeed : 0);
+}
 
-    for (int RKStep = 1; RKStep <= 4; RKStep++) {
-        //		double xVel = 0, yVel = 0;
-
-        // tracer multithreading
-        int tracersPerThread = NUM_TRACERS/THREADCOUNT;
-        if (THREADCOUNT > 1) {
-            for (int thread = 0; thread < THREADCOUNT; thread++) {
-                struct Tracer *tracerArrayPiece = &tracers[thread * tracersPerThread];
-                long radPieceStartIndex = calculateTracerRadiiIndex(tracerArrayPiece[0].tIndex, 0);
-                double *tracerRadArrayPiece = &tracerRadii[radPieceStartIndex];
-                double *intermediateTracerRadArrayPiece = &intermediateTracerRads[radPieceStartIndex];
+#pragma mark - Spatial Ordering
 
-                if (thread == THREADCOUNT - 1) {
-                    // if the tracers couldn't be evenly divided between threads, then we just put the extra ones on the last thread.
-                    // TODO: do a better job of splitting this up. In the worst case, the last thread could have 2*(tracersPerThread)-1 tracers
+/**
+  spread the low 16 bits of a number out to the even bits
+  */
+unsigned int spreadBits(unsigned int bits) {
+    bits &= 0xFFFF;
+    bits = (bits | (bits << 8)) & 0x00FF00FF;
+    bits = (bits | (bits << 4)) & 0x0F0F0F0F;
+    bits = (bits | (bits << 2)) & 0x33333333;
+    bits = (bits | (bits << 1)) & 0x55555555;
+    return bits;
+}
 
-                    tracersPerThread += NUM_TRACERS%THREADCOUNT;
-                }
+/**
+  find the position of a point along a Z-order (Morton) curve through the driver domain. The domain is split into a 2^16 by 2^16 grid,
+  and the key interleaves the bits of the point's grid column and row, so points with close keys are close in space. Points outside of
+  the domain are put in the closest grid cell on its edge.
+  */
+unsigned int mortonKey(double x, double y) {
+    double column = x / DOMAIN_SIZE_X * 65536;
+    double row = y / DOMAIN_SIZE_Y * 65536;
+    unsigned int gridX = (column <= 0) ? 0 : (column < 65535) ? (unsigned int)column : 65535;
+    unsigned int gridY = (row <= 0) ? 0 : (row < 65535) ? (unsigned int)row : 65535;
+    return spreadBits(gridX) | (spreadBits(gridY) << 1);
+}
 
-                // you can only pass 1 parameter to a function being run by another thread. To get around this, you create a struct with all the information
-                // you want to pass, then just pass a pointer to that struct as the 1 parameter to the function. 
-                struct TracerArgs *args = malloc(sizeof(struct TracerArgs));
-                args->RKStep = RKStep;
-                args->tracers = tracerArrayPiece;
-                args->numTracers = tracersPerThread;
-                args->tracerRadii = tracerRadArrayPiece;
-                args->intermediateTracerRads = intermediateTracerRadArrayPiece;
-                args->vortices = vortices;
-
-                thpool_add_work(thpool, stepForwardTracerRK4, args);
-            }
+const unsigned int *sortingKeys; // the keys compareMortonKeys() sorts by
 
-            thpool_wait(thpool);
+int compareMortonKeys(const void *a, const void *b) {
+    int indexA = *(const int *)a;
+    int indexB = *(const int *)b;
+    if (sortingKeys[indexA] != sortingKeys[indexB]) return (sortingKeys[indexA] < sortingKeys[indexB]) ? -1 : 1;
+    return indexA - indexB;
+}
 
-        } else { // just run on the main thread to make debugging easier if there's only 1 thread
-            struct TracerArgs *args = malloc(sizeof(struct TracerArgs));
-            args->RKStep = RKStep;
-            args->tracers = tracers;
-            args->numTracers = tracersPerThread;
-            args->tracerRadii = tracerRadii;
-            args->intermediateTracerRads = intermediateTracerRads;
-            args->vortices = vortices;
+/**
+  find the order which puts a set of points along the Z-order curve. Points with the same key keep their current order.
 
-            stepForwardTracerRK4(args);
+  @param work the workspace, which holds the keys and the order
+  @return the index of the point which belongs at each position, in work->sortOrder
+  */
+int *mortonOrder(struct Workspace *work, const double *x, const double *y, int count) {
+    if (count > work->sortAllocated) {
+        work->sortAllocated = count * 1.5;
+        work->sortKeys = countedRealloc(work->sortKeys, sizeof(unsigned int) * work->sortAllocated);
+        work->sortOrder = countedRealloc(work->sortOrder, sizeof(int) * work->sortAllocated);
+        work->sortScratch = countedRealloc(work->sortScratch, sizeof(double) * work->sortAllocated);
+        if (work->sortKeys == NULL || work->sortOrder == NULL || work->sortScratch == NULL) {
+            printf("Error reallocating the sort workspace");
+            exit(1);
         }
+    }
 
-        /********* end of tracer step code **************/
-
-        for (int originVortIndex = 0; originVortIndex < numDriverVorts; originVortIndex++) {
-            struct VortexArgs *args = malloc(sizeof(struct VortexArgs));
-            args->RKStep = RKStep;
-            args->vortices = vortices;
-            args->originVortIndex = originVortIndex;
-            args->intermediateRadii = intermediateRadii;
-            args->workingRadii = workingRadii;
-            args->vortRadLen = vortRadLen;
-            args->intermediateTracerRads = intermediateTracerRads;
-            args->numTracers = NUM_TRACERS;
+    for (int i = 0; i < count; i++) {
+        work->sortKeys[i] = mortonKey(x[i], y[i]);
+        work->sortOrder[i] = i;
+    }
+    sortingKeys = work->sortKeys;
+    qsort(work->sortOrder, count, sizeof(int), compareMortonKeys);
+    return work->sortOrder;
+}
 
-            thpool_add_work(thpool, stepForwardVortexRK4, args);
-        }
+/**
+  rearrange an array so that position i holds the element which was at order[i]
 
-        thpool_wait(thpool);
+  @param array the array to rearrange
+  @param size the size of each element. No more than sizeof(double)
+  @param scratch room for count elements
+  */
+void permuteArray(void *array, size_t size, const int *order, int count, void *scratch) {
+    char *elements = array;
+    char *permuted = scratch;
+    for (int i = 0; i < count; i++) memcpy(&permuted[i * size], &elements[order[i] * size], size);
+    memcpy(elements, permuted, size * count);
+}
 
-        memcpy(intermediateRadii, workingRadii, vortRadSize);
-        memcpy(workingRadii, vortRadii, vortRadSize);
-    }
+/**
+  reorder the vortices and tracers along a Z-order curve, so that the particles which are next to each other in the arrays are also next
+  to each other in space. After enough timesteps of mixing, the particles end up scattered through memory in the order they were spawned
+  or laid out in, and every spatial solver (the cell list, the trees, the particle mesh and the tracer chunks) walks through them in a cache
+  friendly order again after this. Each particle keeps its ID, so the output still identifies them the same way.
+
+  @param work the workspace
+  @param vortices the vortex arrays
+  @param vortexRadii the vortex radii array, or NULL if the radii arrays aren't in use. They are recalculated for the new order
+  @param tracers the tracer arrays
+  @param tracerRadii the tracer radii array
+  @param numTracers the number of tracers
+  */
+void sortParticles(struct Workspace *work, struct Vortices *vortices, double *vortexRadii, struct Tracers *tracers, double *tracerRadii, int numTracers) {
+    int *order = mortonOrder(work, vortices->x, vortices->y, numDriverVorts);
+    permuteArray(vortices->id, sizeof(long), order, numDriverVorts, work->sortScratch);
+    permuteArray(vortices->x, sizeof(double), order, numDriverVorts, work->sortScratch);
+    permuteArray(vortices->y, sizeof(double), order, numDriverVorts, work->sortScratch);
+    permuteArray(vortices->u, sizeof(double), order, numDriverVorts, work->sortScratch);
+    permuteArray(vortices->v, sizeof(double), order, numDriverVorts, work->sortScratch);
+    permuteArray(vortices->gamma, sizeof(double), order, numDriverVorts, work->sortScratch);
+    permuteArray(vortices->initStep, sizeof(int), order, numDriverVorts, work->sortScratch);
+
+    order = mortonOrder(work, tracers->x, tracers->y, numTracers);
+    permuteArray(tracers->id, sizeof(int), order, numTracers, work->sortScratch);
+    permuteArray(tracers->x, sizeof(double), order, numTracers, work->sortScratch);
+    permuteArray(tracers->y, sizeof(double), order, numTracers, work->sortScratch);
+    permuteArray(tracers->u, sizeof(double), order, numTracers, work->sortScratch);
+    permuteArray(tracers->v, sizeof(double), order, numTracers, work->sortScratch);
+
+    // every row and column of the radii arrays moved, and recalculating them is as cheap as moving them
+    updateRadii_pythagorean(vortexRadii, vortices, tracerRadii, tracers, numTracers);
+}
 
-    for (int i = 0; i < numDriverVorts; ++i) {
-        struct Vortex *vort = &vortices[i];
-        vort->position[0] += vort->velocity[0] * timestep;
-        vort->position[1] += vort->velocity[1] * timestep;
-    }
+#pragma mark - Vortex Lifecycle
 
-    for (int i = 0; i < numTracers; ++i) {
-        struct Tracer *tracer = &tracers[i];
-        tracer->position[0] += tracer->velocity[0] * timestep;
-        tracer->position[1] += tracer->velocity[1] * timestep;
-    }
+/**
+  delete a vortex, and all associated data, from the simulation. The last vortex is moved into its place, so only that vortex's row and
+  column of the vortex radii and its column of the tracer radii have to be moved, rather than repacking the whole arrays.
 
-    memcpy(tracerRadii, intermediateTracerRads, tracerRadSize);
+  @param index the index of the vortex to delete
+  @param vortexRads the array of doubles containing all vortex <-> vortex radius data, or NULL if the radii arrays aren't in use
+  @param vorts the vortex arrays
+  @param tracerRads the array of doubles containing all tracer <-> vortex radius data
+  */
+void deleteVortex(int index, double *vortexRads, struct Vortices *vorts, double *tracerRads) {
+    int last = numDriverVorts - 1;
+
+    if (index != last) {
+        vorts->id[index] = vorts->id[last];
+        vorts->initStep[index] = vorts->initStep[last];
+        vorts->x[index] = vorts->x[last];
+        vorts->y[index] = vorts->y[last];
+        vorts->u[index] = vorts->u[last];
+        vorts->v[index] = vorts->v[last];
+        vorts->gamma[index] = vorts->gamma[last];
+
+        if (vortexRads != NULL) {
+            // the radii to the vortices before index are stored as x_last - x_j in both rows, so they copy straight across
+            memcpy(&vortexRads[calculateVortexRadiiIndex(index, 0)], &vortexRads[calculateVortexRadiiIndex(last, 0)], sizeof(double) * 3 * index);
+
+            // the vortices between index and last store x_i - x_index in their rows, which is the negative of what row last holds
+            for (int i = index + 1; i < last; i++) {
+                long destIndex = calculateVortexRadiiIndex(i, index);
+                long sourceIndex = calculateVortexRadiiIndex(last, i);
+                vortexRads[destIndex] = vortexRads[sourceIndex];
+                vortexRads[destIndex+1] = -vortexRads[sourceIndex+1];
+                vortexRads[destIndex+2] = -vortexRads[sourceIndex+2];
+            }
 
-    free(workingRadii);
-    free(intermediateRadii);
-    free(intermediateTracerRads);
-    pthread_mutex_destroy(&radMutex);
+            for (int tracerIndex = 0; tracerIndex < NUM_TRACERS; tracerIndex++) {
+                memcpy(&tracerRads[calculateTracerRadiiIndex(tracerIndex, index)], &tracerRads[calculateTracerRadiiIndex(tracerIndex, last)], sizeof(double) * 3);
+            }
+        }
+    }
 
-    saveIntermediateVortPositions(numDriverVorts, intPositionCache);
+    // out of date radii are moved like any others, so the vortex in the hole stays dirty if the last vortex was
+    if (vortexRads != NULL) {
+        if (dirtyRadii.isDirty[index]) dirtyRadii.count--;
+        dirtyRadii.isDirty[index] = dirtyRadii.isDirty[last];
+        dirtyRadii.isDirty[last] = 0;
+    }
 
-    free(intPositionCache);
+    // the last row of the triangle and the last column of the tracer radii are now unused
+    numDriverVorts--;
 }
 
-#pragma mark - Vortex Lifecycle
-
 /**
-  delete a vortex and all associated data from the simulation
+  delete every vortex which is marked for deletion from the simulation by packing the remaining vortices down in order. This touches every
+  radius, so it's only worth it when a large part of the vortices are being deleted at once.
 
-  @param vort the vortex to remove
-  @param vorts the array of vortices
+  @param status the status of each vortex, VORTEX_DELETED for the ones to delete. This is packed down along with the vortices
+  @param vortexRads the array of doubles containing all vortex <-> vortex radius data, or NULL if the radii arrays aren't in use
+  @param vorts the vortex arrays
   @param tracerRads the array of doubles containing all tracer <-> vortex radius data
   */
-void deleteVortex(struct Vortex *vort, double *vortexRads, struct Vortex *vorts, double *tracerRads) {
-    int deletionIndex = vort->vIndex;
+void packVortices(char *status, double *vortexRads, struct Vortices *vorts, double *tracerRads) {
+    // every radius moves to an index at or before where it was, so both radii arrays can be packed from the front
+    if (vortexRads != NULL) {
+        int newRow = 0;
+        for (int row = 0; row < numDriverVorts; row++) {
+            if (status[row] == VORTEX_DELETED) continue;
+
+            long destIndex = calculateVortexRadiiIndex(newRow++, 0);
+            long sourceIndex = calculateVortexRadiiIndex(row, 0);
+            for (int col = 0; col < row; col++, sourceIndex += 3) {
+                if (status[col] == VORTEX_DELETED) continue;
+                memmove(&vortexRads[destIndex], &vortexRads[sourceIndex], sizeof(double) * 3);
+                destIndex += 3;
+            }
+        }
 
-    // remove vortex from vortexRadii array
+        for (int tracerIndex = 0; tracerIndex < NUM_TRACERS; tracerIndex++) {
+            long destIndex = calculateTracerRadiiIndex(tracerIndex, 0);
+            long sourceIndex = destIndex;
+            for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++, sourceIndex += 3) {
+                if (status[vortIndex] == VORTEX_DELETED) continue;
+                memmove(&tracerRads[destIndex], &tracerRads[sourceIndex], sizeof(double) * 3);
+                destIndex += 3;
+            }
+        }
+    }
 
-    double *destPtr;
-    double *sourcePtr;
-    for (int rowIndex = deletionIndex; rowIndex < numDriverVorts - 1; rowIndex++) {
-        // shift radii up a row if they are before the column being deleted
-        destPtr = &vortexRads[calculateVortexRadiiIndex(0, rowIndex)];
-        sourcePtr = &vortexRads[calculateVortexRadiiIndex(0, rowIndex+1)];
-        memmove(destPtr, sourcePtr, deletionIndex * sizeof(double) * 3);
+    int newIndex = 0;
+    for (int i = 0; i < numDriverVorts; i++) {
+        if (status[i] == VORTEX_DELETED) continue;
+
+        vorts->id[newIndex] = vorts->id[i];
+        vorts->initStep[newIndex] = vorts->initStep[i];
+        vorts->x[newIndex] = vorts->x[i];
+        vorts->y[newIndex] = vorts->y[i];
+        vorts->u[newIndex] = vorts->u[i];
+        vorts->v[newIndex] = vorts->v[i];
+        vorts->gamma[newIndex] = vorts->gamma[i];
+        status[newIndex] = status[i];
+        if (vortexRads != NULL) dirtyRadii.isDirty[newIndex] = dirtyRadii.isDirty[i];
+        newIndex++;
+    }
 
-        if (rowIndex == numDriverVorts-2)
-            // shift radii up and left if they are after the column being deleted
-            destPtr = &vortexRads[calculateVortexRadiiIndex(deletionIndex, rowIndex)];
-        sourcePtr = &vortexRads[calculateVortexRadiiIndex(deletionIndex + 1, rowIndex+1)];
-        memmove(destPtr, sourcePtr, (rowIndex - deletionIndex) * sizeof(double) * 3);
+    if (vortexRads != NULL) {
+        dirtyRadii.count = 0;
+        for (int i = 0; i < newIndex; i++) dirtyRadii.count += dirtyRadii.isDirty[i];
+        memset(&dirtyRadii.isDirty[newIndex], 0, sizeof(char) * (numDriverVorts - newIndex));
     }
+    numDriverVorts = newIndex;
+}
 
-    // remove vortex's radius data from the tracer radii array
-    for (int tracerI = 0; tracerI < NUM_TRACERS; tracerI++) {
-        long tRadDelIndex = calculateTracerRadiiIndex(tracerI, deletionIndex);
+/**
+  delete every vortex which is marked for deletion from the simulation. Each deletion normally swaps the last vortex into the hole, going from
+  the end of the arrays backwards so that the vortex moved into a hole is never one which still has to be deleted. When so many vortices
+  are deleted that moving their rows and columns one at a time would cost more than packing every radius once, the arrays are packed instead.
 
-        memmove(&tracerRads[tRadDelIndex], &tracerRads[tRadDelIndex+1], (numDriverVorts-deletionIndex) * sizeof(double) * 3);
+  @param status the status of each vortex, VORTEX_DELETED for the ones to delete. This is moved along with the vortices
+  @param vortexRads the array of doubles containing all vortex <-> vortex radius data, or NULL if the radii arrays aren't in use
+  @param vorts the vortex arrays
+  @param tracerRads the array of doubles containing all tracer <-> vortex radius data
+  */
+void deleteVortices(char *status, double *vortexRads, struct Vortices *vorts, double *tracerRads) {
+    int numDeleted = 0;
+    for (int i = 0; i < numDriverVorts; i++) {
+        if (status[i] == VORTEX_DELETED) numDeleted++;
     }
 
-    // remove vortex from vorts array
-    free(vort->position);
-    free(vort->velocity);
-    memmove(&vorts[deletionIndex], &vorts[deletionIndex+1], sizeof(struct Vortex) * (numDriverVorts-deletionIndex-1));
+    if ((long)numDeleted * (numDriverVorts + NUM_TRACERS) > (long)numDriverVorts * (numDriverVorts / 2 + NUM_TRACERS)) {
+        packVortices(status, vortexRads, vorts, tracerRads);
+        return;
+    }
 
-    numDriverVorts--; // has to happen exactly here to avoid OB1 errors
+    for (int i = numDriverVorts - 1; i >= 0; i--) {
+        if (status[i] != VORTEX_DELETED) continue;
 
-    // fix other vorts' vIndex values
-    for (int i = deletionIndex; i < numDriverVorts; i++) vorts[i].vIndex--;
+        status[i] = status[numDriverVorts - 1];
+        deleteVortex(i, vortexRads, vorts, tracerRads);
+    }
+}
+
+/**
+  check the radii arrays against the positions of the vortices and tracers, and exit if any radius is wrong. This is a debugging aid for the
+  code which moves radii around rather than recalculating them, and is turned on with VALIDATE_RADII.
+
+  @param vortexRadii the vortex radii array, or NULL if the radii arrays aren't in use
+  @param vortices the vortex arrays
+  @param tracerRadii the tracer radii array
+  @param tracers the tracer arrays
+  @param numTracers the number of tracers
+  @param where the name of the caller, which is printed with any error
+  */
+void validateRadii(double *vortexRadii, struct Vortices *vortices, double *tracerRadii, struct Tracers *tracers, int numTracers, const char *where) {
+    if (vortexRadii == NULL) return;
+
+    // the radii are recalculated the same way they were calculated in the first place, so they have to match exactly
+    for (int i = 1; i < numDriverVorts; i++) {
+        long index = calculateVortexRadiiIndex(i, 0);
+        for (int j = 0; j < i; j++, index += 3) {
+            double xRad = vortices->x[i] - vortices->x[j];
+            double yRad = vortices->y[i] - vortices->y[j];
+            if (vortexRadii[index+1] != xRad || vortexRadii[index+2] != yRad || vortexRadii[index] != sqrt(xRad * xRad + yRad * yRad)) {
+                printf("Error in %s: the radius between vortices %i and %i is (%f, %f, %f), should be (%f, %f, %f)\n", where, i, j,
+                        vortexRadii[index], vortexRadii[index+1], vortexRadii[index+2], sqrt(xRad * xRad + yRad * yRad), xRad, yRad);
+                exit(1);
+            }
+        }
+    }
+    for (int tracerIndex = 0; tracerIndex < numTracers; tracerIndex++) {
+        long index = calculateTracerRadiiIndex(tracerIndex, 0);
+        for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++, index += 3) {
+            double xRad = vortices->x[vortIndex] - tracers->x[tracerIndex];
+            double yRad = vortices->y[vortIndex] - tracers->y[tracerIndex];
+            if (tracerRadii[index+1] != xRad || tracerRadii[index+2] != yRad || tracerRadii[index] != sqrt(xRad * xRad + yRad * yRad)) {
+                printf("Error in %s: the radius between tracer %i and vortex %i is (%f, %f, %f), should be (%f, %f, %f)\n", where, tracerIndex, vortIndex,
+                        tracerRadii[index], tracerRadii[index+1], tracerRadii[index+2], sqrt(xRad * xRad + yRad * yRad), xRad, yRad);
+                exit(1);
+            }
+        }
+    }
 }
 
 int nextVortID = 0;
@@ -730,20 +1533,20 @@ int nextVortID = 0;
  then initializing a new one, however it doesn't require an O(n) (where n is the total number of vortices being simulated)
  deletion from the array of vortices.
  */
-void randomizeVortex(struct Vortex *vort) {
-    vort->vID = nextVortID++;
-    vort->position[0] = generateUniformRandInRange(0, DOMAIN_SIZE_X);
-    vort->position[1] = generateUniformRandInRange(0, DOMAIN_SIZE_Y);
+void randomizeVortex(struct Vortices *vorts, int index) {
+    vorts->id[index] = nextVortID++;
+    vorts->x[index] = generateUniformRandInRange(0, DOMAIN_SIZE_X);
+    vorts->y[index] = generateUniformRandInRange(0, DOMAIN_SIZE_Y);
 
-    vort->intensity = generateNormalRand(VORTEX_INTENSITY_SIGMA);
+    vorts->gamma[index] = generateNormalRand(VORTEX_INTENSITY_SIGMA);
     double minIntensity = .001;
 
     do {
-        vort->intensity = generateNormalRand(VORTEX_INTENSITY_SIGMA);
-    } while (fabs(vort->intensity) < minIntensity);
-    vort->velocity[0] = 0;
-    vort->velocity[1] = 0;
-    vort->initStep = currentTimestep;
+        vorts->gamma[index] = generateNormalRand(VORTEX_INTENSITY_SIGMA);
+    } while (fabs(vorts->gamma[index]) < minIntensity);
+    vorts->u[index] = 0;
+    vorts->v[index] = 0;
+    vorts->initStep[index] = currentTimestep;
 }
 
 
@@ -761,46 +1564,82 @@ double mergeIntensities(double int1, double int2) {
 /**
   @note this will increment numDriverVorts. It is not neccessary to incrememnt numDriverVorts before/after this function runs
   */
-void spawnVortex(struct Vortex *vorts) {
+void spawnVortex(struct Vortices *vorts) {
     int spawnIndex = numDriverVorts++;
 
-    struct Vortex *vort = &vorts[spawnIndex];
-    vort->vIndex = spawnIndex;
-    vort->position = malloc(sizeof(double) * 2);
-    vort->velocity = calloc(sizeof(double), 2);
-
-    randomizeVortex(vort); // creates random position/intensity
+    randomizeVortex(vorts, spawnIndex); // creates random position/intensity
+    markRadiiDirty(spawnIndex);
 }
 
-void spawnVorts(double **tracerRads, struct Vortex **vorts, double **vortexRadii, int *vortsAllocated, int numVortsToSpawn) {
+void spawnVorts(double **tracerRads, struct Vortices *vorts, double **vortexRadii, int numVortsToSpawn) {
     int spawnsLeft = numVortsToSpawn;
 
-    if (numDriverVorts + spawnsLeft >= *vortsAllocated) {
-        *vortsAllocated = (numDriverVorts + spawnsLeft) * 1.5;
-        *vorts = realloc(*vorts, *vortsAllocated * sizeof(struct Vortex));
+    if (numDriverVorts + spawnsLeft >= vorts->allocated) {
+        resizeVortices(vorts, (numDriverVorts + spawnsLeft) * 2);
 
-        long newVortRadiiLen = (*vortsAllocated * (*vortsAllocated-1))/2; // # of edges in a complete graph of vortsAllocated nodes
-        long newVortRadiiSize = newVortRadiiLen * sizeof(double) * 3;
-        *vortexRadii = realloc(*vortexRadii, newVortRadiiSize);
+        if (useRadiiArrays()) resizeRadii(vortexRadii, tracerRads, vorts->allocated);
+    }
 
-        long newTracerRadiiLen = *vortsAllocated * NUM_TRACERS;
-        long newTracerRadiiSize = newTracerRadiiLen * sizeof(double) * 3;
-        *tracerRads = realloc(*tracerRads, newTracerRadiiSize);
+    while (spawnsLeft--) {
+        spawnVortex(vorts);
+    }
+}
 
-        if (*vorts == NULL) {
-            printf("Error reallocating vorts array");
-            exit(1);
-        } else if (*vorts == NULL) {
-            printf("Error reallocating vorts array");
-            exit(1);
-        } else if (*vorts == NULL) {
-            printf("Error reallocating vorts array");
-            exit(1);
-        }
+/**
+  find the root of a vortex's merge cluster, pointing the vortices along the way closer to it
+
+  @param parent the parent of each vortex in the cluster forest. Roots are their own parent
+  */
+int findClusterRoot(int *parent, int vortIndex) {
+    while (parent[vortIndex] != vortIndex) {
+        parent[vortIndex] = parent[parent[vortIndex]];
+        vortIndex = parent[vortIndex];
     }
+    return vortIndex;
+}
 
-    while (spawnsLeft--) {
-        spawnVortex(*vorts);
+/**
+  join the merge clusters of two vortices. The vortex with the lowest index in a cluster is always its root
+  */
+void joinClusters(int *parent, int vortIndex1, int vortIndex2) {
+    int root1 = findClusterRoot(parent, vortIndex1);
+    int root2 = findClusterRoot(parent, vortIndex2);
+    if (root1 < root2) {
+        parent[root2] = root1;
+    } else if (root2 < root1) {
+        parent[root1] = root2;
+    }
+}
+
+/**qsort comparator for vortex indices*/
+int compareVortexIndices(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+/**
+  join the merge clusters of two vortices if they are within VORTEX_MERGE_RADIUS of eachother, measuring across the edges of the periodic
+  domain. Vortices joined for the first time this round are added to joined
+
+  @param flags the MERGE_ flags of each vortex
+  @param joined the vortices joined to another this round
+  @param numJoined the length of joined
+  */
+void joinIfClose(struct Vortices *vorts, int *parent, char *flags, int *joined, int *numJoined, int vortIndex1, int vortIndex2) {
+    // minimum image radius between the vortices
+    double xRad = vorts->x[vortIndex2] - vorts->x[vortIndex1];
+    double yRad = vorts->y[vortIndex2] - vorts->y[vortIndex1];
+    xRad -= DOMAIN_SIZE_X * round(xRad / DOMAIN_SIZE_X);
+    yRad -= DOMAIN_SIZE_Y * round(yRad / DOMAIN_SIZE_Y);
+    if (sqrt(xRad * xRad + yRad * yRad) >= VORTEX_MERGE_RADIUS) return;
+
+    joinClusters(parent, vortIndex1, vortIndex2);
+    if (!(flags[vortIndex1] & MERGE_JOINED)) {
+        flags[vortIndex1] |= MERGE_JOINED;
+        joined[(*numJoined)++] = vortIndex1;
+    }
+    if (!(flags[vortIndex2] & MERGE_JOINED)) {
+        flags[vortIndex2] |= MERGE_JOINED;
+        joined[(*numJoined)++] = vortIndex2;
     }
 }
 
@@ -809,51 +1648,186 @@ void spawnVorts(double **tracerRads, struct Vortex **vorts, double **vortexRadii
   this function can re-initialize merged vortices rather than doing a niave deletion. This saves having to do lots of memmove's to rearrange
   the radii arrays.
 
+  Close pairs are found with a cell list, measuring distances across the edges of the periodic domain, and grouped into clusters with
+  union-find. Each cluster is merged into the vortex with the lowest index in it, taking the rest of the cluster in index order as if they
+  had been merged one pair at a time. A merged vortex, or a reused one, can land close to another vortex, so only the vortices which moved
+  are checked again, against the cell list for the ones which didn't and a small cell list of the ones which did, until a round joins
+  nothing. The deleted vortices are then swapped out with the last vortex, and only the radii of the vortices which moved are recalculated,
+  through the dirty radii set. The cell list is built once, so a call is O(N) plus the work for the vortices which merged.
+
+  @param firstUnchecked vortices before this are known to be further than VORTEX_MERGE_RADIUS apart, so only the ones from here on are
+  checked against the rest in the first round. 0 checks every pair
   @param spawnsLeft This will spawn no more than spawnsLeft number of vortices. If > spawnsLeft merges happen, then the extra vortices are simply deleted.
 
   @return The remaining number of spawns after merging is complete.
   */
-int mergeVorts(double *vortexRadii, struct Vortex *vorts, double *tracerRads, struct Tracer *tracers, int spawnsLeft, int *totalMerges) {
-    int merges;
-    do {
-        merges = 0;
+int mergeVorts(double *vortexRadii, struct Vortices *vorts, double *tracerRads, struct Tracers *tracers, int firstUnchecked, int spawnsLeft, int *totalMerges) {
+    // kept between calls so that their memory can be reused
+    static struct CellList cells; // every vortex, where it was at the start of the call
+    static struct CellList movedCells; // the vortices which have moved since, where they are now
+    static int *parent = NULL;
+    static char *status = NULL;
+    static char *flags = NULL;
+    static int *active = NULL; // the vortices to check for close neighbors this round
+    static int *joined = NULL;
+    static int *moved = NULL;
+    static double *movedX = NULL;
+    static double *movedY = NULL;
+    static int clustersAllocated = 0;
+
+    if (firstUnchecked >= numDriverVorts) return spawnsLeft;
+
+    if (numDriverVorts > clustersAllocated) {
+        clustersAllocated = numDriverVorts * 1.5;
+        parent = countedRealloc(parent, sizeof(int) * clustersAllocated);
+        status = countedRealloc(status, sizeof(char) * clustersAllocated);
+        flags = countedRealloc(flags, sizeof(char) * clustersAllocated);
+        active = countedRealloc(active, sizeof(int) * clustersAllocated);
+        joined = countedRealloc(joined, sizeof(int) * clustersAllocated);
+        moved = countedRealloc(moved, sizeof(int) * clustersAllocated);
+        movedX = countedRealloc(movedX, sizeof(double) * clustersAllocated);
+        movedY = countedRealloc(movedY, sizeof(double) * clustersAllocated);
+        if (parent == NULL || status == NULL || flags == NULL || active == NULL || joined == NULL || moved == NULL || movedX == NULL || movedY == NULL) {
+            printf("Error reallocating merge clusters");
+            exit(1);
+        }
+    }
+
+    buildCellList(&cells, vorts->x, vorts->y, numDriverVorts, VORTEX_MERGE_RADIUS);
+    for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
+        parent[vortIndex] = vortIndex;
+        status[vortIndex] = VORTEX_UNCHANGED;
+        flags[vortIndex] = 0;
+    }
 
+    int numActive = 0;
+    int numMoved = 0;
+    int numJoined = 0;
+    int merges = 0;
+
+    if (firstUnchecked == 0) {
+        // join every pair of vortices which are close enough to merge
         for (int vortIndex2 = 1; vortIndex2 < numDriverVorts; vortIndex2++) {
-            for (int vortIndex1 = 0; vortIndex1 < vortIndex2; vortIndex1++) {
-                long radIndex = calculateVortexRadiiIndex(vortIndex1, vortIndex2);
-                if (vortexRadii[radIndex] < VORTEX_MERGE_RADIUS) {
-                    merges++;
-
-                    struct Vortex *vort1 = &vorts[vortIndex1];
-                    struct Vortex *vort2 = &vorts[vortIndex2];
-
-                    if (totalMerges) (*totalMerges)++;
-
-                    double absInt1 = fabs(vort1->intensity);
-                    double absInt2 = fabs(vort2->intensity);
-
-                    // compute new position and vorticity
-                    double newXPos = (vort1->position[0]*absInt1 + vort2->position[0]*absInt2) / (absInt1 + absInt2);
-                    double newYPos = (vort1->position[1]*absInt1 + vort2->position[1]*absInt2) / (absInt1 + absInt2);
-                    double newIntensity = mergeIntensities(vort1->intensity, vort2->intensity);
-
-                    vort1->position[0] = newXPos;
-                    vort1->position[1] = newYPos;
-                    vort1->intensity = newIntensity;
-
-                    // i think that deleting vort2 is actually slower than deleting vort1, but the difference should be fairly insignificant
-                    if (spawnsLeft) {
-                        spawnsLeft--;
-                        randomizeVortex(vort2);
-                    } else {
-                        deleteVortex(vort2, vortexRadii, vorts, tracerRads); // a faster way to do this would be to mark each vortex for deletion, then go through and remove them all at once
-                    }
-                    updateRadii_pythagorean(vortexRadii, vorts, tracerRads, tracers, NUM_TRACERS); // if this becomes a significant speed issue, a new function which only computes the relevant radii should be written
-                    break;
+            int neighbors[9];
+            int numNeighbors = cellListNeighbors(&cells, cells.cellOf[vortIndex2], neighbors);
+
+            for (int n = 0; n < numNeighbors; n++) {
+                int cell = neighbors[n];
+                for (int i = cells.cellStart[cell]; i < cells.cellStart[cell + 1]; i++) {
+                    int vortIndex1 = cells.entries[i];
+                    if (vortIndex1 >= vortIndex2) break; // the rest of the cell is sorted after this, and each pair only needs checking once
+
+                    joinIfClose(vorts, parent, flags, joined, &numJoined, vortIndex1, vortIndex2);
                 }
             }
         }
-    } while (merges > 0);
+    } else {
+        for (int vortIndex = firstUnchecked; vortIndex < numDriverVorts; vortIndex++) active[numActive++] = vortIndex;
+    }
+
+    while (1) {
+        // check the active vortices against every vortex which hasn't been deleted. The cell list only has the right position for the
+        // ones which haven't moved, and the rest are in movedCells
+        for (int a = 0; a < numActive; a++) {
+            int vortIndex = active[a];
+            int neighbors[9];
+            int numNeighbors = cellListNeighbors(&cells, cellListCell(&cells, vorts->x[vortIndex], vorts->y[vortIndex]), neighbors);
+            for (int n = 0; n < numNeighbors; n++) {
+                for (int i = cells.cellStart[neighbors[n]]; i < cells.cellStart[neighbors[n] + 1]; i++) {
+                    int other = cells.entries[i];
+                    if (other == vortIndex || status[other] == VORTEX_DELETED || (flags[other] & MERGE_MOVED)) continue;
+                    joinIfClose(vorts, parent, flags, joined, &numJoined, vortIndex, other);
+                }
+            }
+            if (numMoved == 0) continue;
+
+            numNeighbors = cellListNeighbors(&movedCells, cellListCell(&movedCells, vorts->x[vortIndex], vorts->y[vortIndex]), neighbors);
+            for (int n = 0; n < numNeighbors; n++) {
+                for (int i = movedCells.cellStart[neighbors[n]]; i < movedCells.cellStart[neighbors[n] + 1]; i++) {
+                    int other = moved[movedCells.entries[i]];
+                    if (other == vortIndex || status[other] == VORTEX_DELETED) continue;
+                    joinIfClose(vorts, parent, flags, joined, &numJoined, vortIndex, other);
+                }
+            }
+        }
+        if (numJoined == 0) break;
+
+        // merge every joined vortex into the root of its cluster. A root always comes before the rest of its cluster
+        qsort(joined, numJoined, sizeof(int), compareVortexIndices);
+        numActive = 0;
+        for (int j = 0; j < numJoined; j++) {
+            int vortIndex = joined[j];
+            int root = findClusterRoot(parent, vortIndex);
+            if (root == vortIndex) continue;
+
+            merges++;
+
+            if (totalMerges) (*totalMerges)++;
+
+            double absInt1 = fabs(vorts->gamma[root]);
+            double absInt2 = fabs(vorts->gamma[vortIndex]);
+
+            // if the pair is closest across the edge of the domain, use the image of the vortex which is next to the root
+            double xPos2 = vorts->x[vortIndex];
+            double yPos2 = vorts->y[vortIndex];
+            xPos2 -= DOMAIN_SIZE_X * round((xPos2 - vorts->x[root]) / DOMAIN_SIZE_X);
+            yPos2 -= DOMAIN_SIZE_Y * round((yPos2 - vorts->y[root]) / DOMAIN_SIZE_Y);
+
+            // compute new position and vorticity
+            double newXPos = (vorts->x[root]*absInt1 + xPos2*absInt2) / (absInt1 + absInt2);
+            double newYPos = (vorts->y[root]*absInt1 + yPos2*absInt2) / (absInt1 + absInt2);
+            double newIntensity = mergeIntensities(vorts->gamma[root], vorts->gamma[vortIndex]);
+
+            vorts->x[root] = newXPos;
+            vorts->y[root] = newYPos;
+            vorts->gamma[root] = newIntensity;
+            wrapCoordinates(&vorts->x[root], 1, DOMAIN_SIZE_X);
+            wrapCoordinates(&vorts->y[root], 1, DOMAIN_SIZE_Y);
+            markRadiiDirty(root);
+            if (!(flags[root] & MERGE_ACTIVE)) {
+                flags[root] |= MERGE_ACTIVE;
+                active[numActive++] = root;
+            }
+
+            // the merged vortex is reused for a spawn if there are any left, which saves deleting it
+            if (spawnsLeft) {
+                spawnsLeft--;
+                randomizeVortex(vorts, vortIndex);
+                markRadiiDirty(vortIndex);
+                flags[vortIndex] |= MERGE_ACTIVE;
+                active[numActive++] = vortIndex;
+            } else {
+                status[vortIndex] = VORTEX_DELETED;
+            }
+        }
+
+        // the next round starts with fresh clusters, and checks the vortices which moved in this one
+        for (int j = 0; j < numJoined; j++) {
+            parent[joined[j]] = joined[j];
+            flags[joined[j]] &= ~MERGE_JOINED;
+        }
+        numJoined = 0;
+        for (int a = 0; a < numActive; a++) {
+            int vortIndex = active[a];
+            flags[vortIndex] &= ~MERGE_ACTIVE;
+            if (!(flags[vortIndex] & MERGE_MOVED)) {
+                flags[vortIndex] |= MERGE_MOVED;
+                moved[numMoved++] = vortIndex;
+            }
+        }
+        for (int m = 0; m < numMoved; m++) {
+            movedX[m] = vorts->x[moved[m]];
+            movedY[m] = vorts->y[moved[m]];
+        }
+        buildCellList(&movedCells, movedX, movedY, numMoved, VORTEX_MERGE_RADIUS);
+    }
+
+    if (merges > 0) {
+        deleteVortices(status, vortexRadii, vorts, tracerRads);
+        refreshDirtyRadii(vortexRadii, vorts, tracerRads, tracers, NUM_TRACERS);
+    }
+
+    if (VALIDATE_RADII) validateRadii(vortexRadii, vorts, tracerRads, tracers, NUM_TRACERS, "mergeVorts");
 
     return spawnsLeft;
 }
@@ -866,10 +1840,10 @@ int mergeVorts(double *vortexRadii, struct Vortex *vorts, double *tracerRads, st
   @discussion this function does not put any tracers on the edge of the domain. If the space between tracers at t=0 is 1, there is a gap of size 1
   between each edge of the center domain and the closest column/row of tracers.
 
-  @param tracers the array to fill with tracers
+  @param tracers the tracer arrays to fill
   @param n the number of tracers to generate
   */
-void initialize_tracers(struct Tracer *tracers, int n) {
+void initialize_tracers(struct Tracers *tracers, int n) {
     double seperationX = (DOMAIN_SIZE_X) / (sqrt(n) + 1);
     double seperationY = (DOMAIN_SIZE_Y) / (sqrt(n) + 1);
 
@@ -879,22 +1853,22 @@ void initialize_tracers(struct Tracer *tracers, int n) {
 
     for (int row = 1; row <= sqrt(n); row++) {
         for (int col = 1; col <= sqrt(n); col++) {
-            tracers[i].tIndex = i;
-            tracers[i].position = malloc(sizeof(double) * 2);
-            tracers[i].velocity = calloc(sizeof(double), 2);
-
-            tracers[i].position[0] = col * seperationX;
-            tracers[i].position[1] = row * seperationY;
+            tracers->id[i] = i;
+            tracers->x[i] = col * seperationX;
+            tracers->y[i] = row * seperationY;
+            tracers->u[i] = 0;
+            tracers->v[i] = 0;
             i++;
         }
     }
 }
 
-void initialize_single_test_tracer(struct Tracer *tracers, int numTracers, struct Vortex *vorts) {
+void initialize_single_test_tracer(struct Tracers *tracers, int numTracers, struct Vortices *vorts) {
     assert(numTracers == 1);
 
     initialize_tracers(tracers, numTracers);
-    memcpy(tracers[0].position, vorts[0].position, sizeof(double) * 2);
+    tracers->x[0] = vorts->x[0];
+    tracers->y[0] = vorts->y[0];
 }
 
 #pragma mark - misc
@@ -902,16 +1876,19 @@ void initialize_single_test_tracer(struct Tracer *tracers, int numTracers, struc
 /**
   find the smallest radius seperation between vortices
 
-  @param radArr the array of doubles contianing all vortex radius information
+  @param radArr the array of doubles contianing all vortex radius information, or NULL if the radii arrays aren't in use
+  @param vorts the vortex arrays
   @param numVorts the number of active driver vortices
   */
-double minRad(double *radArr, long numVorts) {
-    if (numVorts == 0) return 0;
-    long radLen = (pow(numVorts, 2)-numVorts)/2 * 3;
-
-    double min = radArr[0];
-    for (int i = 0; i < radLen; i += 3) {
-        if (radArr[i] < min) min = radArr[i];
+double minRad(double *radArr, struct Vortices *vorts, long numVorts) {
+    if (numVorts < 2) return 0;
+
+    double min = vortexSeparation(radArr, vorts, 0, 1);
+    for (int i = 1; i < numVorts; i++) {
+        for (int j = 0; j < i; j++) {
+            double rad = vortexSeparation(radArr, vorts, i, j);
+            if (rad < min) min = rad;
+        }
     }
     return min;
 }
@@ -936,9 +1913,9 @@ void pprintVortRads(double *rads, int numActiveVorts) {
 }
 /** print the tracerRads array in a human readable format*/
 void pprintTracerRads(double *rads, int numActiveTracers) {
-    long index = 0;
-    for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
-        for (int tracerIndex = 0; tracerIndex < numActiveTracers; tracerIndex++) {
+    for (int tracerIndex = 0; tracerIndex < numActiveTracers; tracerIndex++) {
+        long index = calculateTracerRadiiIndex(tracerIndex, 0);
+        for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
             printf("|");
             for (int i = 0; i < 3; i++) {
                 printf("%6.2f", rads[index]);
@@ -949,44 +1926,15 @@ void pprintTracerRads(double *rads, int numActiveTracers) {
         printf("|\n");
     }
 }
-/**find vortices/tracers which have moved beyond the edges of the driver domain, and move them to the opposite side of the array.*/
-void wrapPositions(struct Vortex *vorts, struct Tracer *tracers, int numTracers) {
-    for (int i = 0; i < numDriverVorts; i++) {
-        if (vorts[i].position[0] < 0) {
-            vorts[i].position[0] = DOMAIN_SIZE_X + fmod(vorts[i].position[0], DOMAIN_SIZE_X);
-        } else if (vorts[i].position[0] > DOMAIN_SIZE_X) {
-            vorts[i].position[0] =  fmod(vorts[i].position[0], DOMAIN_SIZE_X);
-        }
-        if (vorts[i].position[1] < 0) {
-            vorts[i].position[1] = DOMAIN_SIZE_Y + fmod(vorts[i].position[1], DOMAIN_SIZE_Y);
-        } else if (vorts[i].position[1] > DOMAIN_SIZE_Y) {
-            vorts[i].position[1] = fmod(vorts[i].position[1], DOMAIN_SIZE_Y);
-        }
-    }
-
-    for (int i = 0; i < numTracers; i++) {
-        if (tracers[i].position[0] < 0) {
-            tracers[i].position[0] = DOMAIN_SIZE_X + fmod(tracers[i].position[0], DOMAIN_SIZE_X);;
-        } else if (tracers[i].position[0] > DOMAIN_SIZE_X) {
-            tracers[i].position[0] = fmod(tracers[i].position[0], DOMAIN_SIZE_X);
-        }
-        if (tracers[i].position[1] < 0) {
-            tracers[i].position[1] = DOMAIN_SIZE_Y + fmod(tracers[i].position[1], DOMAIN_SIZE_Y);
-        } else if (tracers[i].position[1] > DOMAIN_SIZE_Y) {
-            tracers[i].position[1] = fmod(tracers[i].position[1], DOMAIN_SIZE_Y);
-        }
-    }
-}
 /**
   find the highest velocity vortex
 
   @return the magnitude of the largest velocity vector
   */
-double maxVelocity(struct Vortex *vorts) {
+double maxVelocity(struct Vortices *vorts) {
     double maxV = 0;
     for (int i = 0; i < numDriverVorts; i++) {
-        struct Vortex *vort = &vorts[i];
-        double totalV = sqrt(pow(vort->velocity[0], 2) + pow(vort->velocity[1], 2));
+        double totalV = sqrt(pow(vorts->u[i], 2) + pow(vorts->v[i], 2));
         if (totalV > maxV) maxV = totalV;
     }
     return maxV;
@@ -1018,82 +1966,101 @@ int calcSpawnCount() {
     }
 }
 
+volatile sig_atomic_t stopSignal = 0; // set when the simulation has been asked to stop
+volatile sig_atomic_t checkpointRequested = 0;
+
 /**
-  handle SIGTERMs
+  handle SIGTERMs and SIGINTs. The simulation finishes the timestep it's on, writes a checkpoint and stops. A second signal stops it
+  right away
   */
 void termination_handler(int sig) {
-#ifdef SAVE_RAWDATA
-    closeFile();
-#endif
-    signal(sig, SIG_DFL);
-    raise(sig);
+    if (stopSignal) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+    stopSignal = sig;
+}
+
+/**
+  handle SIGUSR1, which writes a checkpoint after the timestep the simulation is on
+  */
+void checkpoint_handler(int sig) {
+    checkpointRequested = 1;
+}
+
+/**
+  spawn the first vortices and place the tracers, for a simulation which isn't starting from a file
+  */
+void initializeParticles(struct Vortices *vortices, int *numDriverVorts, double *vortexRadii[], struct Tracers *tracers, double *tracerRadii[]) {
+    *numDriverVorts = 0;
+    resizeVortices(vortices, (VORTEX_CAPACITY > NUM_VORT_INIT*1.5) ? VORTEX_CAPACITY : (int)NUM_VORT_INIT*1.5);
+    allocateTracers(tracers, NUM_TRACERS);
+
+    if (TEST_CASE == 0) {
+        int spawnsRemaining = NUM_VORT_INIT;
+        spawnVorts(tracerRadii, vortices, vortexRadii, spawnsRemaining);
+        initialize_tracers(tracers, NUM_TRACERS);
+        // Generate vortices so that they don't end up being merged on the first timestep.
+    } else {
+        spawnVorts(tracerRadii, vortices, vortexRadii, NUM_VORT_INIT);
+        initialize_test(vortices, *numDriverVorts);
+        if (TEST_CASE != 6) {
+            initialize_tracers(tracers, NUM_TRACERS);
+        } else {
+            initialize_single_test_tracer(tracers, NUM_TRACERS, vortices);
+        }
+    }
 }
 
-void initializeSimulation(struct Vortex *vortices[], int *numDriverVorts, double *vortexRadii[], struct Tracer *tracers[], double *tracerRadii[], int *vorticesAllocated) {
+void initializeSimulation(struct Vortices *vortices, int *numDriverVorts, double *vortexRadii[], struct Tracers *tracers, double *tracerRadii[]) {
     // setup sigterm handlers
     signal(SIGTERM, termination_handler);
     signal(SIGINT, termination_handler);
-    // initialize the threadpool
-    if (THREADCOUNT > 1) {
-        thpool = thpool_init(THREADCOUNT);
-    }
+    signal(SIGUSR1, checkpoint_handler);
+    // start the worker threads
+    initTeam(THREADCOUNT);
+
+    timestep = TIMESTEP_CONST;
 
     // if INITFNAME isn't an empty string, INIT_TIME_STEP isn't negative, and TEST_CASE is 0
     // then we initialie the simulation from the file given by INITFNAME, starting at the 
     // timestep given by INIT_TIME_STEP
     if (INITFNAME[0] && INIT_TIME_STEP >= 0 && TEST_CASE == 0) {
-        initFromFile(INITFNAME, INIT_TIME_STEP, vortices, numDriverVorts, vorticesAllocated, tracers);
-    }
-    // seed the RNG
-    if (FIRST_SEED == -1) {
-        currentTimestep = 0;
-        time((time_t *)&lastX);
+        if (SAVE_RAWDATA && strcmp(INITFNAME, DATA_OUT_FILEPATH) == 0) {
+            printf("Error: saving the raw data to %s would overwrite the file the simulation starts from", INITFNAME);
+            exit(1);
+        }
 
-        printf("First random seed is %li\n", lastX);
+        initFromFile(INITFNAME, INIT_TIME_STEP, vortices, numDriverVorts, tracers);
+        if (VORTEX_CAPACITY > vortices->allocated) resizeVortices(vortices, VORTEX_CAPACITY);
     } else {
-        lastX = FIRST_SEED;
-    }
-
-    numDriverVorts = 0;
-    *vorticesAllocated = (int)NUM_VORT_INIT*1.5;
-    // vortices is the array of Vortex structs
-    *vortices = malloc(sizeof(struct Vortex) * *vorticesAllocated);
+        // seed the RNG
+        if (FIRST_SEED == -1) {
+            currentTimestep = 0;
+            time((time_t *)&lastX);
 
-    // tracers is the array of Tracer structs
-    *tracers = malloc(sizeof(struct Tracer) * NUM_TRACERS);
-
-    if (TEST_CASE == 0) {
-        int spawnsRemaining = NUM_VORT_INIT;
-        spawnVorts(tracerRadii, vortices, vortexRadii, vorticesAllocated, spawnsRemaining);
-        initialize_tracers(*tracers, NUM_TRACERS);
-        // Generate vortices so that they don't end up being merged on the first timestep.
-    } else {
-        spawnVorts(tracerRadii, vortices, vortexRadii, vorticesAllocated, NUM_VORT_INIT);
-        initialize_test(*vortices, *numDriverVorts);
-        if (TEST_CASE != 6) {
-            initialize_tracers(*tracers, NUM_TRACERS);
+            printf("First random seed is %li\n", lastX);
         } else {
-            initialize_single_test_tracer(*tracers, NUM_TRACERS, *vortices);
+            lastX = FIRST_SEED;
         }
-    }
 
-    unsigned long vortexRadiiSize = sizeof(double) * (calculateVortexRadiiIndex(*vorticesAllocated-1, *vorticesAllocated-2) + 3);
-
-    // vortexRadii is the matrix of distances between vortices. The distance between vortex vIndex==a and vortex vIndex==b (where a < b) is at index 3*(a*(a+1)/2+b).
-    // the next item in the array is the x-component of the distance, and then the y-component of the distance
-    // r, r_x, r_y
-
-    *vortexRadii = malloc(vortexRadiiSize);
+        initializeParticles(vortices, numDriverVorts, vortexRadii, tracers, tracerRadii);
+    }
 
-    long tracerRadSize = NUM_TRACERS * *vorticesAllocated * sizeof(double) * 3;
-    *tracerRadii = malloc(tracerRadSize); // row = vortex, col = tracer; Note: vortPos - tracerPos
+    if (useRadiiArrays()) {
+        // vortexRadii is the matrix of distances between vortices. The distance between vortex a and vortex b (where a < b) is at index 3*(a*(a+1)/2+b).
+        // the next item in the array is the x-component of the distance, and then the y-component of the distance
+        // r, r_x, r_y
+        // tracerRadii has a row for each tracer, with a column for each vortex; Note: vortPos - tracerPos
+        resizeRadii(vortexRadii, tracerRadii, vortices->allocated);
 
-    updateRadii_pythagorean(*vortexRadii, *vortices, *tracerRadii, *tracers, NUM_TRACERS);
+        updateRadii_pythagorean(*vortexRadii, vortices, *tracerRadii, tracers, NUM_TRACERS);
+    }
     
     // set nextVortID to be one more than the highest vortex ID.
     for (int i = 0; i < *numDriverVorts; i++) {
-        if ((*vortices[i]).vID >= nextVortID) {
-            nextVortID = (*vortices[i]).vID;
+        if (vortices->id[i] >= nextVortID) {
+            nextVortID = vortices->id[i] + 1;
         }
     }
 }
@@ -1101,20 +2068,41 @@ void initializeSimulation(struct Vortex *vortices[], int *numDriverVorts, double
 #pragma mark - Main
 
 int main(int argc, const char * argv[]) {
-    struct Vortex *vortices;
-    struct Tracer *tracers;
-    double *vortexRadii;
-    double *tracerRadii;
-    int vorticesAllocated;
+    struct Vortices vortices = {0};
+    struct Tracers tracers = {0};
+    double *vortexRadii = NULL;
+    double *tracerRadii = NULL;
 
     // load values for constants from the config file
     importConstants("./config"); 
+    // the tabulated periodic kernel only depends on the domain size, so it is loaded once
+    if (PERIODIC_KERNEL) loadPeriodicKernel();
+    if (BINARY_RAWDATA && SAVE_RK_STEPS) {
+        fprintf(stderr, "config warning: the binary raw data format doesn't hold runge-kutta steps, ignoring SAVE_RK_STEPS\n");
+        SAVE_RK_STEPS = 0;
+    }
+    if (SAVE_RK_STEPS && OUTPUT_BUFFERS > 0) {
+        fprintf(stderr, "config warning: runge-kutta steps are written during the timestep, so SAVE_RK_STEPS writes the output synchronously\n");
+        OUTPUT_BUFFERS = 0;
+    }
+    if (TEST_CASE == 6 && VELOCITY_SOLVER != SOLVER_DIRECT) {
+        fprintf(stderr, "config warning: test case 6 skips vortices within .1 of a tracer, which only the direct solver does, using it instead\n");
+        VELOCITY_SOLVER = SOLVER_DIRECT;
+    }
+    if (TRACER_SINGLE_PRECISION && (VELOCITY_SOLVER != SOLVER_DIRECT || PERIODIC_KERNEL)) {
+        fprintf(stderr, "config warning: TRACER_SINGLE_PRECISION only applies to the direct solver without PERIODIC_KERNEL, ignoring it\n");
+        TRACER_SINGLE_PRECISION = 0;
+    }
+    initBiotSavart(SIMD_LEVEL, domains + 1);
     // initialize the vortices and drivers. Either write zeros into the arrays, or read data from the
     // input file into the simulation. 
-    initializeSimulation(&vortices, &numDriverVorts, &vortexRadii, &tracers, &tracerRadii, &vorticesAllocated);
+    initializeSimulation(&vortices, &numDriverVorts, &vortexRadii, &tracers, &tracerRadii);
+    // opened before the first timestep, which writes the RK steps before it saves its state
+    if (SAVE_RAWDATA) openFile();
 
     struct timespec initFinishedTime;
     clock_gettime(CLOCK_MONOTONIC, &initFinishedTime);
+    resetHeapAllocations(); // only count the allocations made by timesteps
 
     // only used to verify that the simulation matches the analytic solution to test case #4
     // not really useful for anything else
@@ -1131,7 +2119,7 @@ int main(int argc, const char * argv[]) {
         // and tracers to the console. This is sometimes useful for debugging.
         if (DRAW_CONSOLE) {
             if (currentTimestep%RENDER_NTH_STEP == 0) {
-                drawToConsole(vortices, numDriverVorts, tracers);
+                drawToConsole(&vortices, numDriverVorts, &tracers);
                 for (int c = 0; c < ceil(log10(currentTimestep)) + 1; c++) printf("\010");
                 printf("%i", currentTimestep);
                 struct timespec sleepDuration;
@@ -1145,60 +2133,88 @@ int main(int argc, const char * argv[]) {
         // if DRAW_PNG is true then we save pdf images (which can be assembled into video)
         if (DRAW_PNG) {
             if (currentTimestep%RENDER_NTH_STEP == 0) {
-                char *filename = malloc(sizeof(char) * 50);
+                char filename[50];
                 genFName(filename, currentTimestep);
 
                 clock_gettime(CLOCK_MONOTONIC, &startTime);
-                drawToFile(vortices, numDriverVorts, tracers, filename);
-                free(filename);
+                drawToFile(&vortices, numDriverVorts, &tracers, filename);
                 clock_gettime(CLOCK_MONOTONIC, &endTime);
             }
         }
 
         // generate parameters used to verify that this simulator matches the analytic solution for test case 4
         if (TEST_CASE == 4) {
-            double minR = minRad(vortexRadii, numDriverVorts);
-            double maxV = maxVelocity(vortices);
+            double minR = minRad(vortexRadii, &vortices, numDriverVorts);
+            double maxV = maxVelocity(&vortices);
             timestep = minR / maxV * .5;
             if (timestep > TIMESTEP_CONST || maxV == 0) timestep = TIMESTEP_CONST;
 
             currentTime += timestep;
-            if (currentTime > 50) return 0;
+            // leave through the end of main, which writes out the queued timesteps and the binary index
+            if (currentTime > 50) break;
         }
+        // compared before the timestep starts, so it isn't counted in the step time
+        if (TRACER_SINGLE_PRECISION && TRACER_PRECISION_REPORT > 0 && currentTimestep % TRACER_PRECISION_REPORT == 0) {
+            reportTracerPrecision(&vortices, tracerRadii, &tracers, NUM_TRACERS);
+        }
+
         clock_gettime(CLOCK_MONOTONIC, &startTime);
 
+        if (MORTON_SORT_INTERVAL > 0 && currentTimestep % MORTON_SORT_INTERVAL == 0) {
+            sortParticles(&workspace, &vortices, vortexRadii, &tracers, tracerRadii, NUM_TRACERS);
+        }
+
         // merge and spawn vortices
         if (VORTEX_LIFECYCLE) {
             int numSpawns = calcSpawnCount();
             printf("spawning %i vorts\n", numSpawns);
             int totalMergeCount = 0;
-            int spawnsLeft = mergeVorts(vortexRadii, vortices, tracerRadii, tracers, numSpawns, &totalMergeCount);
-            spawnVorts(&tracerRadii, &vortices, &vortexRadii, &vorticesAllocated, spawnsLeft);
-            updateRadii_pythagorean(vortexRadii, vortices, tracerRadii, tracers, NUM_TRACERS);
-            mergeVorts(vortexRadii, vortices, tracerRadii, tracers, 0, &totalMergeCount);
+            int spawnsLeft = mergeVorts(vortexRadii, &vortices, tracerRadii, &tracers, 0, numSpawns, &totalMergeCount);
+            int firstSpawned = numDriverVorts;
+            spawnVorts(&tracerRadii, &vortices, &vortexRadii, spawnsLeft);
+            refreshDirtyRadii(vortexRadii, &vortices, tracerRadii, &tracers, NUM_TRACERS);
+            // only the new vortices can be close to another one
+            mergeVorts(vortexRadii, &vortices, tracerRadii, &tracers, firstSpawned, 0, &totalMergeCount);
             printf("timestep: %i, time: %.5f, totMerges: %i\n", currentTimestep, currentTimestep * timestep, totalMergeCount);
         }
 
-        // compute the new positions of tracers and vortices using runge-kutta 4th order
-        stepForward_RK4(vortices, vortexRadii, tracerRadii, tracers, NUM_TRACERS);
-        // find vortices which have moved out of the domain, then move them to their new positions
-        wrapPositions(vortices, tracers, NUM_TRACERS);
-        // after warping, the radii arrays may not be correct, so I recalculate them. Since this only happens once per
-        // time step, this computation takes a negligable amount of time.
-        updateRadii_pythagorean(vortexRadii, vortices, tracerRadii, tracers, NUM_TRACERS);
+        // compute the new positions of tracers and vortices using runge-kutta 4th order. This also moves vortices which have
+        // moved out of the domain back into it, and recalculates the radii arrays for the new positions
+        if (useRadiiArrays()) {
+            stepForward_RK4(&vortices, vortexRadii, tracerRadii, &tracers, NUM_TRACERS);
+        } else {
+            stepForward_RK4_positions(&vortices, &tracers, NUM_TRACERS);
+        }
 
         clock_gettime(CLOCK_MONOTONIC, &endTime);
         double sec = (endTime.tv_sec - startTime.tv_sec) + (double)(endTime.tv_nsec - startTime.tv_nsec) / 1E9;
         printf("Step number %i calculation complete in %f sec with %i vortices\n", currentTimestep, sec, numDriverVorts);
+        if (useRadiiArrays()) printf("Refreshed %li radii after merging and spawning\n", dirtyRadii.refreshed);
+        printf("Made %li heap allocations\n", heapAllocations());
+        dirtyRadii.refreshed = 0;
+        resetHeapAllocations();
 
-        // if SAVE_RAWDATA, then we save the position once per timestep
+        // if SAVE_RAWDATA, then we save the position once per timestep. It's written while the next timestep runs, unless the
+        // writer has fallen OUTPUT_BUFFERS timesteps behind
         if (SAVE_RAWDATA) {
-            if (currentTimestep == 0) openFile();
-            saveState(currentTimestep, lastX, numDriverVorts, NUM_TRACERS, vortices,tracers);
+            double waited = outputState(currentTimestep, lastX, numDriverVorts, NUM_TRACERS, &vortices, &tracers);
+            if (waited > 0) printf("Waited %f sec for the output writer\n", waited);
         }
 
-        fflush(stdout);
         currentTimestep++;
+
+        // checkpoints are taken between timesteps, when the radii arrays can be recalculated from the positions alone
+        // the raw data file is flushed first, so that a run resumed from the checkpoint finds every timestep before it
+        if (stopSignal || checkpointRequested || (CHECKPOINT_INTERVAL > 0 && currentTimestep % CHECKPOINT_INTERVAL == 0)) {
+            if (SAVE_RAWDATA) flushOutput();
+            saveCheckpoint(CHECKPOINT_FILEPATH, numDriverVorts, &vortices, NUM_TRACERS, &tracers);
+            checkpointRequested = 0;
+        }
+        fflush(stdout);
+        if (stopSignal) {
+            printf("Stopped by signal %i\n", (int)stopSignal);
+            break;
+        }
     }
 
     struct timespec simFinishedTime;
@@ -1206,25 +2222,15 @@ int main(int argc, const char * argv[]) {
     double sec = (simFinishedTime.tv_sec - initFinishedTime.tv_sec) + (double)(simFinishedTime.tv_nsec - initFinishedTime.tv_nsec) / 1E9;
     printf("Total simulation runtime: %f\n", sec);
 
-    for (int vortIndex = 0; vortIndex < numDriverVorts; vortIndex++) {
-        free(vortices[vortIndex].position);
-        free(vortices[vortIndex].velocity);
-    }
+    freeVortices(&vortices);
+    freeTracers(&tracers);
+    freeRadii(vortexRadii, tracerRadii);
+    freeWorkspace(&workspace);
+    free(dirtyRadii.isDirty);
+    freeTeam();
 
-    for (int tracerIndex = 0; tracerIndex < NUM_TRACERS; tracerIndex++) {
-        free(tracers[tracerIndex].position);
-        free(tracers[tracerIndex].velocity);
-    }
-
-    free(vortices);
-    free(tracers);
-    free(vortexRadii);
-    free(tracerRadii);
-    thpool_destroy(thpool);
-
-#ifdef SAVE_RAWDATA
-    closeFile();
-#endif
+    // the binary format's index of the timesteps is written when the file is closed
+    if (SAVE_RAWDATA) closeFile();
 
     return 0;
 }
@@ -8,17 +8,39 @@
 #define main_h
 
 #include <pthread.h>
+#include "quadtree.h"
+#include "fmm.h"
+#include "particleMesh.h"
 
 extern int currentTimestep;
+extern double timestep;
+extern double carryoverSpawnCount;
+extern int vortsSpawned;
 
-struct Vortex {
-    long vID; // unique vortex ID
-	int vIndex;
-	int initStep;
-	
-	double intensity;
-	double *position;
-	double *velocity; // this is change in coord. per time step
+#define TRACER_CHUNK_SIZE 32 // tracers handed out to a thread at a time
+#define TRACER_COST_GRID 16 // vortex density used to estimate tracer costs is counted on a grid of this many cells per side
+
+// what happens to a vortex while merging
+#define VORTEX_UNCHANGED 0
+#define VORTEX_DELETED 1
+
+// where a vortex is up to while merging, as bits
+#define MERGE_JOINED 1 // joined to another vortex's cluster this round
+#define MERGE_ACTIVE 2 // to be checked for close neighbors next round
+#define MERGE_MOVED 4 // moved since the cell list was built
+
+// every vortex in the simulation, stored as one array per field so that loops over the vortices stream through memory.
+// A vortex's index in these arrays is also its index in the radii arrays. The arrays all live in one block, see resizeVortices()
+struct Vortices {
+	int allocated; // length of each array
+	long *id; // unique vortex ID
+	int *initStep;
+
+	double *x;
+	double *y;
+	double *u; // this is change in coord. per time step
+	double *v;
+	double *gamma; // intensity
 };
 
 struct Vector {
@@ -28,40 +50,128 @@ struct Vector {
 };
 
 struct RKPositions {
-    struct Vortex *vort;
+    long vID;
     struct Vector step1Pos;
     struct Vector step2Pos;
     struct Vector step3Pos;
     struct Vector step4Pos;
 };
 
-struct Tracer {
-	int tIndex;
-	
-	double *position;
-	double *velocity; // this is change in coord. per time step
+// every tracer in the simulation, stored the same way as the vortices, in one block starting at x
+struct Tracers {
+	int *id;
+
+	double *x;
+	double *y;
+	double *u; // this is change in coord. per time step
+	double *v;
 };
 
-// used to pass vortex info between threads
-struct VortexArgs {
-	int RKStep;
-	struct Vortex *vortices;
-	int originVortIndex;
-	double *intermediateRadii;
-	double *workingRadii;
-	long vortRadLen;
-	double *intermediateTracerRads;
-	int numTracers;
+// the order the team works through chunks of tracers in. Chunks are dealt out from most to least expensive, so that every member's
+// teamBlock() of slots starts out with about the same estimated cost
+struct TracerSchedule {
+	int numChunks;
+	int chunksAllocated;
+	int *order; // the chunk to run at each slot. Chunk c holds tracers c * TRACER_CHUNK_SIZE to (c + 1) * TRACER_CHUNK_SIZE - 1
+	double *cost; // estimated cost of each chunk
+	int *sorted; // chunk indices from most to least expensive
 };
 
-// used to pass tracer info between threads
-struct TracerArgs {
-	int RKStep;
-	struct Tracer *tracers;
+// shared by the threads of the team while they move the simulation forward one timestep
+struct StepContext {
+	struct Vortices *vortices;
+	struct Tracers *tracers;
 	int numTracers;
+	struct TracerSchedule *tracerSchedule;
+	struct RKPositions *positionCache; // the position of each vortex after each stage, for SAVE_RK_STEPS
+
+	double *kX; // velocity of each particle at the current stage
+	double *kY;
+	double *tracerKX;
+	double *tracerKY;
+
+	// radii integrator
+	long vortRadLen;
+	double *vortexRadii; // radii at the start of the timestep
 	double *tracerRadii;
+	double *intermediateRadii; // radii at the current stage, after the first
+	double *intermediateTracerRads;
+	double *dX; // displacement of each particle at the next stage
+	double *dY;
+	double *tracerDX;
+	double *tracerDY;
+
+	// positions integrator
+	struct VelocitySolver *solver;
+	double *stageX; // position of each particle at the current stage
+	double *stageY;
+	double *tracerStageX;
+	double *tracerStageY;
+};
+
+// the vortices whose radii are out of date after being spawned or moved, so that only their rows and columns of the radii arrays have to
+// be recalculated instead of all of them
+struct DirtyRadii {
+	int count; // number of dirty vortices
+	char *isDirty; // a flag for each vortex, as long as the vortex arrays
+	long refreshed; // radii recalculated since this was last reset
+};
+
+// passed to parallelFor() to calculate the velocities of every vortex or every tracer chunk at one RK stage
+struct StageVelocities {
+	struct StepContext *step;
+	int stage;
+};
+
+// state of the velocity solvers, kept between timesteps so that their memory can be reused
+struct VelocitySolver {
+	// the direct solver just keeps the stage positions of the sources
+	double *sourceX;
+	double *sourceY;
+	double *sourceGamma;
+	int numSources;
+
+	struct QuadTree tree;
+	struct FMM fmm;
+	struct ParticleMesh mesh;
+};
+
+// every scratch buffer the integrators use. It's kept for the whole simulation, and its buffers only grow when the population goes past
+// what they have room for, so a timestep in the steady state doesn't allocate anything
+struct Workspace {
+	int vortsAllocated;
+	int tracersAllocated;
+	int radiiAllocated; // vortices the intermediate radii have room for
+
+	struct RKPositions *positionCache;
+	double *kX;
+	double *kY;
+	double *dX;
+	double *dY;
+	double *stageX;
+	double *stageY;
+	double *tracerKX;
+	double *tracerKY;
+	double *tracerDX;
+	double *tracerDY;
+	double *tracerStageX;
+	double *tracerStageY;
+	double *intermediateRadii; // reserved like the radii arrays, with the same capacity
 	double *intermediateTracerRads;
-	struct Vortex *vortices;
+
+	// reordering the particles along a Z-order curve
+	int sortAllocated;
+	unsigned int *sortKeys;
+	int *sortOrder;
+	double *sortScratch;
+
+	struct TracerSchedule tracerSchedule;
+	struct VelocitySolver solver;
 };
 
+void resizeVortices(struct Vortices *vortices, int allocated);
+void freeVortices(struct Vortices *vortices);
+void allocateTracers(struct Tracers *tracers, int numTracers);
+void freeTracers(struct Tracers *tracers);
+
 #endif /* main_h */
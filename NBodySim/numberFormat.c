@@ -0,0 +1,212 @@
+//
+//  numberFormat.c
+//  NBodySim
+//
+
+#include "numberFormat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FIXED_DECIMALS 15
+#define FIXED_SCALE 1000000000000000ull // 10^FIXED_DECIMALS
+#define SHORTEST_MAX_DECIMALS 27 // the most decimals putShortest() tries before falling back to snprintf(), enough for 17 digits from 1e-10 up
+
+typedef unsigned __int128 uint128;
+
+static const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+static const uint64_t powersOf10[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+    10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull, 1000000000000000ull,
+    10000000000000000ull, 100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+static const uint64_t powersOf5[] = {
+    1ull, 5ull, 25ull, 125ull, 625ull, 3125ull, 15625ull, 78125ull, 390625ull, 1953125ull, 9765625ull, 48828125ull,
+    244140625ull, 1220703125ull, 6103515625ull, 30517578125ull, 152587890625ull, 762939453125ull, 3814697265625ull,
+    19073486328125ull, 95367431640625ull, 476837158203125ull, 2384185791015625ull, 11920928955078125ull,
+    59604644775390625ull, 298023223876953125ull, 1490116119384765625ull, 7450580596923828125ull
+};
+
+/**
+ write the decimal digits of a number, padded with leading zeros to at least minDigits
+
+ @param minDigits at most 40
+ */
+static char *putDigits(char *out, uint64_t value, int minDigits) {
+    char buffer[40];
+    char *start = buffer + sizeof(buffer);
+    while (value >= 100) {
+        start -= 2;
+        memcpy(start, &digitPairs[(value % 100) * 2], 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        start -= 2;
+        memcpy(start, &digitPairs[value * 2], 2);
+    } else {
+        *--start = '0' + value;
+    }
+    while (buffer + sizeof(buffer) - start < minDigits) *--start = '0';
+
+    size_t length = buffer + sizeof(buffer) - start;
+    memcpy(out, start, length);
+    return out + length;
+}
+
+char *putInteger(char *out, long value) {
+    if (value < 0) {
+        *out++ = '-';
+        return putDigits(out, -(uint64_t)value, 1);
+    }
+    return putDigits(out, value, 1);
+}
+
+/**
+ printf("%.15f"). A double below 2^52 is mantissa / 2^shift, so its fraction times 10^15 is an integer over a power of 2, which
+ fits in 128 bits and can be rounded exactly
+ */
+char *putFixed(char *out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int exponent = (bits >> 52) & 0x7ff;
+    if (exponent == 0x7ff || exponent >= 1075) return out + snprintf(out, FORMATTED_NUMBER_MAX, "%.15f", value);
+
+    if (bits >> 63) *out++ = '-';
+    uint64_t intPart = 0;
+    uint64_t fraction = 0;
+    // subnormals are far too small to show up in 15 decimals
+    if (exponent != 0) {
+        uint64_t mantissa = (bits & ((1ull << 52) - 1)) | (1ull << 52);
+        int shift = 1075 - exponent;
+        uint64_t fractionBits = mantissa;
+        if (shift < 64) {
+            intPart = mantissa >> shift;
+            fractionBits = mantissa & ((1ull << shift) - 1);
+        }
+
+        // fractionBits * 10^15 is below 2^103, so any further shift rounds to 0
+        if (shift < 104) {
+            uint128 scaled = (uint128)fractionBits * FIXED_SCALE;
+            fraction = (uint64_t)(scaled >> shift);
+            uint128 remainder = scaled - ((uint128)fraction << shift);
+            uint128 half = (uint128)1 << (shift - 1);
+            if (remainder > half || (remainder == half && (fraction & 1))) fraction++;
+            if (fraction == FIXED_SCALE) {
+                fraction = 0;
+                intPart++;
+            }
+        }
+    }
+
+    out = putDigits(out, intPart, 1);
+    *out++ = '.';
+    return putDigits(out, fraction, FIXED_DECIMALS);
+}
+
+/**
+ the shortest "%.*g" which reads back as the same double
+ */
+static char *putShortestFallback(char *out, double value) {
+    int length = 0;
+    for (int precision = 1; precision <= 17; precision++) {
+        length = snprintf(out, FORMATTED_NUMBER_MAX, "%.*g", precision, value);
+        if (strtod(out, NULL) == value) break;
+    }
+    return out + length;
+}
+
+/**
+ whether a number with some count of decimals reads back as the double value. Measured in quarters of the last bit of value's
+ mantissa, value is 4 * mantissa, and every number between the midpoints to the doubles on either side of it reads back as it. The
+ numbers with k decimals are multiples of 2^shift / 10^k quarters, and scaling everything by 5^k leaves them multiples of
+ 2^(shift + 2 - k), so only the two multiples around value have to be checked
+
+ @param digits set to the closest fitting number, times 10^decimals
+ */
+static char decimalsFit(uint64_t mantissa, uint128 lower, uint128 upper, char inclusive, int shift, int decimals, uint128 *digits) {
+    int step = shift + 2 - decimals;
+    uint128 center = ((uint128)mantissa << 2) * powersOf5[decimals];
+    lower *= powersOf5[decimals];
+    upper *= powersOf5[decimals];
+
+    uint128 below = center >> step;
+    uint128 belowValue = below << step;
+    uint128 aboveValue = (below + 1) << step;
+    char belowFits = inclusive ? belowValue >= lower : belowValue > lower;
+    char aboveFits = inclusive ? aboveValue <= upper : aboveValue < upper;
+
+    *digits = below;
+    if (belowFits && aboveFits) {
+        uint128 belowDistance = center - belowValue;
+        uint128 aboveDistance = aboveValue - center;
+        if (aboveDistance < belowDistance || (aboveDistance == belowDistance && (below & 1))) *digits = below + 1;
+    } else if (aboveFits) {
+        *digits = below + 1;
+    }
+    return belowFits || aboveFits;
+}
+
+/**
+ the fewest decimals which read back as the same double. If some count of decimals fits, so does every larger count, so the
+ fewest is found with a binary search, starting from a count whose spacing is finer than the gap between doubles
+ */
+char *putShortest(char *out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int exponent = (bits >> 52) & 0x7ff;
+    if ((bits << 1) == 0) {
+        if (bits >> 63) *out++ = '-';
+        memcpy(out, "0.0", 3);
+        return out + 3;
+    }
+    int shift = 1075 - exponent;
+    // the shifts in decimalsFit() have to stay below 128
+    if (exponent == 0 || exponent == 0x7ff || shift <= 0 || shift > 125) return putShortestFallback(out, value);
+
+    uint64_t mantissa = (bits & ((1ull << 52) - 1)) | (1ull << 52);
+    uint128 lower = ((uint128)mantissa << 2) - ((mantissa == 1ull << 52 && exponent > 1) ? 1 : 2);
+    uint128 upper = ((uint128)mantissa << 2) + 2;
+    // the midpoints themselves read back as the double with the even mantissa
+    char inclusive = (mantissa & 1) == 0;
+
+    // the gap between the midpoints is at least 3/4 of 2^-shift, and 10^-(log10(2) * shift + 1) is finer than that. With shift
+    // decimals, value is written exactly
+    int high = ((shift * 78913) >> 18) + 2;
+    if (high > shift) high = shift;
+    if (high > SHORTEST_MAX_DECIMALS) high = SHORTEST_MAX_DECIMALS;
+    uint128 digits;
+    if (!decimalsFit(mantissa, lower, upper, inclusive, shift, high, &digits)) return putShortestFallback(out, value);
+
+    int low = 0;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (decimalsFit(mantissa, lower, upper, inclusive, shift, middle, &digits)) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    int decimals = high;
+    decimalsFit(mantissa, lower, upper, inclusive, shift, decimals, &digits);
+
+    // at most 17 significant digits are ever needed, so the digits fit in 64 bits, and past 19 decimals there is no integer part
+    uint64_t intPart = 0;
+    uint64_t fraction = (uint64_t)digits;
+    if (decimals < 20) {
+        intPart = (uint64_t)digits / powersOf10[decimals];
+        fraction = (uint64_t)digits % powersOf10[decimals];
+    }
+
+    if (bits >> 63) *out++ = '-';
+    out = putDigits(out, intPart, 1);
+    *out++ = '.';
+    if (decimals == 0) {
+        *out++ = '0';
+        return out;
+    }
+    return putDigits(out, fraction, decimals);
+}
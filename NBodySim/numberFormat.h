@@ -0,0 +1,24 @@
+//
+//  numberFormat.h
+//  NBodySim
+//
+
+#ifndef numberFormat_h
+#define numberFormat_h
+
+/*
+ Writes numbers as text for the raw data file, without going through printf.
+
+ putFixed() writes exactly what printf("%.15f") would, including the rounding of ties to even, by working out the
+ digits from the exact value of the double with integer arithmetic. putShortest() writes the fewest decimals which
+ read back as the same double. Numbers too large or too small for the integer arithmetic, and infinities and NaNs,
+ fall back to snprintf(). None of them write a terminating null.
+ */
+
+#define FORMATTED_NUMBER_MAX 330 // longest text any of these write, -DBL_MAX with 15 decimals
+
+char *putFixed(char *out, double value);
+char *putShortest(char *out, double value);
+char *putInteger(char *out, long value);
+
+#endif /* numberFormat_h */
@@ -0,0 +1,181 @@
+//
+//  numberFormatTest.c
+//  NBodySim
+//
+//  Compares numberFormat.c against the C library. putFixed() has to write exactly what printf("%.15f") does, and putShortest()
+//  has to write a number which reads back as the same double, with no fewer decimals possible. Run by test.sh, optionally with
+//  the number of random values to try from each group.
+//
+
+#include "numberFormat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define DEFAULT_COUNT 200000
+#define MAX_REPORTED 10 // failures printed for each group
+
+static uint64_t randomState = 88172645463325252ull;
+static long failures = 0;
+static long reported = 0;
+
+static uint64_t randomBits(void) {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 7;
+    randomState ^= randomState << 17;
+    return randomState;
+}
+
+static double fromBits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#pragma mark - Values
+
+enum ValueGroup {
+    ANY_BITS,
+    TIES, // halfway between two numbers with 15 decimals, or between two doubles' shortest decimals
+    SUBNORMALS,
+    HUGE_VALUES, // 2^52 and up, which have no fraction bits
+    NEAR_INTEGERS, // within a few bits of an integer, where rounding carries into the integer part
+    WIDE_MAGNITUDES,
+    POSITIONS, // the range vortex and tracer positions and velocities are in
+    NUM_GROUPS
+};
+
+static const char *groupNames[] = {"any bits", "ties", "subnormals", "2^52 and up", "near integers", "1e-25 to 1e15", "positions"};
+
+static double randomValue(enum ValueGroup group) {
+    uint64_t bits = randomBits();
+    double sign = (bits & 1) ? -1 : 1;
+    switch (group) {
+        case ANY_BITS:
+            return fromBits(bits);
+        case TIES:
+            // a dyadic fraction with up to 80 bits after the point. With 16 to 20, the 16th decimal is often exactly a 5
+            if (bits & 2) return sign * ldexp((double)((bits >> 12) % 2000001), -16 - (int)(randomBits() % 5));
+            return sign * ldexp((double)(bits >> 11), -(int)(randomBits() % 80));
+        case SUBNORMALS:
+            return fromBits((bits & 0x800fffffffffffffull));
+        case HUGE_VALUES:
+            return fromBits((bits & 0x800fffffffffffffull) | ((uint64_t)(1075 + randomBits() % (0x7ff - 1075)) << 52));
+        case NEAR_INTEGERS:
+            return sign * ((double)(randomBits() % 1000000) + ldexp((double)(bits >> 60) - 8, -52 + (int)(randomBits() % 30)));
+        case WIDE_MAGNITUDES:
+            return sign * ((double)(bits >> 11) / 9007199254740992.0) * pow(10, (int)(randomBits() % 40) - 25);
+        default:
+            return ((double)(bits >> 11) / 9007199254740992.0 - .5) * 128;
+    }
+}
+
+static const double specialValues[] = {
+    0.0, -0.0, 0.5, 1.0, 0.1, 0.7, 1e15, 1e-15, 5e-16, -5e-16, 4.9999999999999999e-16, 1.5e-15, 2.5e-15, 1.0 / 65536, 3.0 / 65536,
+    63.99999999999999, 0.9999999999999995, 0.99999999999999956, 4503599627370495.5, 4503599627370496.0, 9007199254740993.0,
+    1e300, -1e308, 5e-324, 1e-320, -1e-320, 2.2250738585072014e-308, 1.7976931348623157e308, INFINITY, -INFINITY, NAN, -NAN
+};
+
+#pragma mark - Checks
+
+static void fail(const char *group, const char *check, double value, const char *got, const char *expected) {
+    failures++;
+    if (reported++ < MAX_REPORTED) printf("FAIL %s, %s for %a: got %s, expected %s\n", group, check, value, got, expected);
+}
+
+static void checkFixed(const char *group, double value) {
+    char got[FORMATTED_NUMBER_MAX + 1];
+    char expected[FORMATTED_NUMBER_MAX + 1];
+    *putFixed(got, value) = '\0';
+    snprintf(expected, sizeof(expected), "%.15f", value);
+    if (strcmp(got, expected) != 0) fail(group, "putFixed", value, got, expected);
+}
+
+/**
+ putShortest() has to read back as the same double, down to the sign of zero. Unless it fell back to exponent notation, one decimal
+ fewer, rounded correctly, must not read back as the same double
+ */
+static void checkShortest(const char *group, double value) {
+    char got[FORMATTED_NUMBER_MAX + 1];
+    char shorter[FORMATTED_NUMBER_MAX + 1];
+    *putShortest(got, value) = '\0';
+
+    double readBack = strtod(got, NULL);
+    if (isnan(value)) {
+        if (!isnan(readBack)) fail(group, "putShortest", value, got, "nan");
+        return;
+    } else if (readBack != value || signbit(readBack) != signbit(value)) {
+        fail(group, "putShortest", value, got, "the same double");
+        return;
+    }
+
+    char *point = strchr(got, '.');
+    if (point == NULL || strchr(got, 'e') != NULL || strcmp(point, ".0") == 0) return;
+    int decimals = (int)strlen(point + 1);
+    snprintf(shorter, sizeof(shorter), "%.*f", decimals - 1, value);
+    if (strtod(shorter, NULL) == value) fail(group, "putShortest", value, got, shorter);
+}
+
+#pragma mark - Timing
+
+static void timeFormats(void) {
+    const int count = 1000000;
+    double *values = malloc(sizeof(double) * count);
+    char *buffer = malloc(FORMATTED_NUMBER_MAX * 1000);
+    for (int i = 0; i < count; i++) values[i] = randomValue(POSITIONS) / 16;
+
+    const char *names[] = {"printf(\"%.15f\")", "putFixed", "putShortest", "printf(\"%.17g\")"};
+    for (int method = 0; method < 4; method++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long length = 0;
+        for (int i = 0; i < count; i++) {
+            char *out = buffer + (i % 1000) * FORMATTED_NUMBER_MAX;
+            if (method == 0) length += sprintf(out, "%.15f", values[i]);
+            else if (method == 1) length += putFixed(out, values[i]) - out;
+            else if (method == 2) length += putShortest(out, values[i]) - out;
+            else length += sprintf(out, "%.17g", values[i]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ns = ((end.tv_sec - start.tv_sec) * 1E9 + (end.tv_nsec - start.tv_nsec)) / count;
+        printf("%-18s %6.1f ns and %4.1f characters a number\n", names[method], ns, (double)length / count);
+    }
+    free(values);
+    free(buffer);
+}
+
+#pragma mark - Main
+
+int main(int argc, const char * argv[]) {
+    long count = (argc > 1) ? atol(argv[1]) : DEFAULT_COUNT;
+
+    reported = 0;
+    for (int i = 0; i < (int)(sizeof(specialValues) / sizeof(specialValues[0])); i++) {
+        checkFixed("special values", specialValues[i]);
+        checkShortest("special values", specialValues[i]);
+    }
+    printf("%s special values\n", (failures == 0) ? "ok" : "FAILED");
+
+    for (int group = 0; group < NUM_GROUPS; group++) {
+        long failuresBefore = failures;
+        reported = 0;
+        for (long i = 0; i < count; i++) {
+            double value = randomValue(group);
+            checkFixed(groupNames[group], value);
+            checkShortest(groupNames[group], value);
+        }
+        printf("%s %li values, %s\n", (failures == failuresBefore) ? "ok" : "FAILED", count, groupNames[group]);
+    }
+
+    timeFormats();
+
+    if (failures) {
+        printf("%li failures\n", failures);
+        return 1;
+    }
+    printf("No errors\n");
+    return 0;
+}
@@ -0,0 +1,267 @@
+//
+//  particleMesh.c
+//  NBodySim
+//
+
+#include "particleMesh.h"
+#include "fft.h"
+#include "constants.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ move a position into [0, size)
+ */
+static double wrapCoordinate(double coord, double size) {
+    coord -= size * floor(coord / size);
+    return (coord >= size) ? 0 : coord;
+}
+
+static int wrapIndex(int index, int size) {
+    index %= size;
+    return (index < 0) ? index + size : index;
+}
+
+/**
+ find the lower left grid point of the cell containing a position, and the cloud-in-cell weights of the point above and to the right of it
+ */
+static void cloudInCell(struct ParticleMesh *mesh, double x, double y, int *gridX, int *gridY, double *fracX, double *fracY) {
+    double u = wrapCoordinate(x, DOMAIN_SIZE_X) / mesh->spacingX;
+    double v = wrapCoordinate(y, DOMAIN_SIZE_Y) / mesh->spacingY;
+    *gridX = (int)floor(u);
+    *gridY = (int)floor(v);
+    *fracX = u - *gridX;
+    *fracY = v - *gridY;
+    *gridX = wrapIndex(*gridX, mesh->gridSize);
+    *gridY = wrapIndex(*gridY, mesh->gridSize);
+}
+
+static double sinc(double x) {
+    return (x == 0) ? 1 : sin(x) / x;
+}
+
+/**
+ allocate the grid and pick the P3M split for the current PM_GRID_SIZE and domain size
+ */
+static void setupMesh(struct ParticleMesh *mesh) {
+    mesh->gridSize = PM_GRID_SIZE;
+    mesh->spacingX = (double)DOMAIN_SIZE_X / PM_GRID_SIZE;
+    mesh->spacingY = (double)DOMAIN_SIZE_Y / PM_GRID_SIZE;
+    mesh->grid = countedRealloc(mesh->grid, sizeof(double complex) * PM_GRID_SIZE * PM_GRID_SIZE);
+    if (mesh->grid == NULL) {
+        printf("Error allocating the particle mesh");
+        exit(1);
+    }
+
+    mesh->shortRange = P3M_CORRECTION;
+    mesh->sigma = P3M_SPLIT_CELLS * fmax(mesh->spacingX, mesh->spacingY);
+    mesh->cutoff = P3M_CUTOFF_WIDTHS * mesh->sigma;
+    if (mesh->shortRange && 2 * mesh->cutoff > fmin(DOMAIN_SIZE_X, DOMAIN_SIZE_Y)) {
+        printf("Error: the P3M cutoff (%f) is more than half the domain size. Increase PM_GRID_SIZE\n", mesh->cutoff);
+        exit(1);
+    }
+
+    mesh->cellsX = (int)(DOMAIN_SIZE_X / mesh->cutoff);
+    mesh->cellsY = (int)(DOMAIN_SIZE_Y / mesh->cutoff);
+    if (mesh->cellsX < 1) mesh->cellsX = 1;
+    if (mesh->cellsY < 1) mesh->cellsY = 1;
+}
+
+/**
+ sort the sources into cells for the short range sum
+ */
+static void binSources(struct ParticleMesh *mesh, const double *x, const double *y, const double *gamma, int numSources) {
+    int numCells = mesh->cellsX * mesh->cellsY;
+    if (numCells > mesh->cellsAllocated) {
+        mesh->cellsAllocated = numCells;
+        mesh->cellStart = countedRealloc(mesh->cellStart, sizeof(int) * (numCells + 1));
+        mesh->cellFill = countedRealloc(mesh->cellFill, sizeof(int) * numCells);
+    }
+    if (numSources > mesh->sourcesAllocated) {
+        mesh->sourcesAllocated = numSources * 1.5;
+        mesh->sourceX = countedRealloc(mesh->sourceX, sizeof(double) * mesh->sourcesAllocated);
+        mesh->sourceY = countedRealloc(mesh->sourceY, sizeof(double) * mesh->sourcesAllocated);
+        mesh->sourceGamma = countedRealloc(mesh->sourceGamma, sizeof(double) * mesh->sourcesAllocated);
+        mesh->sourceIndex = countedRealloc(mesh->sourceIndex, sizeof(int) * mesh->sourcesAllocated);
+        mesh->cellOf = countedRealloc(mesh->cellOf, sizeof(int) * mesh->sourcesAllocated);
+    }
+    if (mesh->cellStart == NULL || mesh->cellFill == NULL || (numSources && (mesh->sourceIndex == NULL || mesh->cellOf == NULL))) {
+        printf("Error reallocating P3M cell arrays");
+        exit(1);
+    }
+    mesh->numSources = numSources;
+
+    int *cellOf = mesh->cellOf;
+    memset(mesh->cellStart, 0, sizeof(int) * (numCells + 1));
+    for (int i = 0; i < numSources; i++) {
+        int cellX = (int)(wrapCoordinate(x[i], DOMAIN_SIZE_X) / DOMAIN_SIZE_X * mesh->cellsX);
+        int cellY = (int)(wrapCoordinate(y[i], DOMAIN_SIZE_Y) / DOMAIN_SIZE_Y * mesh->cellsY);
+        if (cellX >= mesh->cellsX) cellX = mesh->cellsX - 1;
+        if (cellY >= mesh->cellsY) cellY = mesh->cellsY - 1;
+        cellOf[i] = cellY * mesh->cellsX + cellX;
+        mesh->cellStart[cellOf[i] + 1]++;
+    }
+    for (int cell = 0; cell < numCells; cell++) mesh->cellStart[cell + 1] += mesh->cellStart[cell];
+
+    int *cellFill = mesh->cellFill;
+    memcpy(cellFill, mesh->cellStart, sizeof(int) * numCells);
+    for (int i = 0; i < numSources; i++) {
+        int sorted = cellFill[cellOf[i]]++;
+        mesh->sourceX[sorted] = wrapCoordinate(x[i], DOMAIN_SIZE_X);
+        mesh->sourceY[sorted] = wrapCoordinate(y[i], DOMAIN_SIZE_Y);
+        mesh->sourceGamma[sorted] = gamma[i];
+        mesh->sourceIndex[sorted] = i;
+    }
+}
+
+/**
+ Deposit a set of vortices onto the mesh and solve for the velocity at every grid point. After this, the velocity at any
+ point can be found with meshVelocity().
+
+ @param mesh the mesh to (re)build. Memory from a previous build is reused
+ @param x array of vortex x-positions. These don't need to be inside of the driver domain
+ @param y array of vortex y-positions
+ @param gamma array of vortex intensities
+ @param numSources the length of the x, y and gamma arrays
+ */
+void buildParticleMesh(struct ParticleMesh *mesh, const double *x, const double *y, const double *gamma, int numSources) {
+    if (mesh->grid == NULL || mesh->gridSize != PM_GRID_SIZE || mesh->shortRange != P3M_CORRECTION
+            || mesh->spacingX != (double)DOMAIN_SIZE_X / PM_GRID_SIZE || mesh->spacingY != (double)DOMAIN_SIZE_Y / PM_GRID_SIZE) {
+        setupMesh(mesh);
+    }
+
+    int size = mesh->gridSize;
+    double cellArea = mesh->spacingX * mesh->spacingY;
+    memset(mesh->grid, 0, sizeof(double complex) * size * size);
+
+    // cloud-in-cell deposition of the vorticity
+    for (int i = 0; i < numSources; i++) {
+        int gridX, gridY;
+        double fracX, fracY;
+        cloudInCell(mesh, x[i], y[i], &gridX, &gridY, &fracX, &fracY);
+
+        int nextX = (gridX + 1) % size, nextY = (gridY + 1) % size;
+        double vorticity = gamma[i] / cellArea;
+        mesh->grid[gridY * size + gridX] += vorticity * (1 - fracX) * (1 - fracY);
+        mesh->grid[gridY * size + nextX] += vorticity * fracX * (1 - fracY);
+        mesh->grid[nextY * size + gridX] += vorticity * (1 - fracX) * fracY;
+        mesh->grid[nextY * size + nextX] += vorticity * fracX * fracY;
+    }
+
+    fft2D(mesh->grid, size, size, 0);
+
+    // psi = omega / k^2, u = i*ky*psi and v = -i*kx*psi. The cloud-in-cell window is divided out once for the
+    // deposition and once for the interpolation.
+    for (int j = 0; j < size; j++) {
+        int modeY = (j < size / 2) ? j : j - size;
+        double ky = 2 * M_PI * modeY / DOMAIN_SIZE_Y;
+        double windowY = sinc(ky * mesh->spacingY / 2);
+
+        for (int i = 0; i < size; i++) {
+            int modeX = (i < size / 2) ? i : i - size;
+            double kx = 2 * M_PI * modeX / DOMAIN_SIZE_X;
+            double windowX = sinc(kx * mesh->spacingX / 2);
+            double complex *cell = &mesh->grid[j * size + i];
+
+            // the k = 0 mode is the background vorticity, and the nyquist modes have no well defined derivative
+            if ((!modeX && !modeY) || modeX == -size / 2 || modeY == -size / 2) {
+                *cell = 0;
+                continue;
+            }
+
+            double kSquared = kx * kx + ky * ky;
+            double window = windowX * windowX * windowY * windowY;
+            double complex psi = *cell / (kSquared * window * window);
+            if (mesh->shortRange) psi *= exp(-kSquared * mesh->sigma * mesh->sigma / 2);
+
+            // the transforms of u and v are combined so that one inverse FFT gives u + iv, since both are real
+            *cell = I * ky * psi + kx * psi;
+        }
+    }
+
+    fft2D(mesh->grid, size, size, 1);
+
+    if (mesh->shortRange) binSources(mesh, x, y, gamma, numSources);
+}
+
+void freeParticleMesh(struct ParticleMesh *mesh) {
+    free(mesh->grid);
+    free(mesh->cellStart);
+    free(mesh->cellFill);
+    free(mesh->sourceX);
+    free(mesh->sourceY);
+    free(mesh->sourceGamma);
+    free(mesh->sourceIndex);
+    free(mesh->cellOf);
+    memset(mesh, 0, sizeof(struct ParticleMesh));
+}
+
+/**
+ Calculate the velocity at a point by interpolating from the mesh, plus the P3M short range part if it is enabled.
+
+ @param mesh a mesh built by buildParticleMesh()
+ @param x the x-position of the target
+ @param y the y-position of the target
+ @param selfIndex the source index of the target if it is one of the vortices in the mesh, otherwise -1
+ @param xVel Pointer to a double which will be incremented by the x-velocity at the target
+ @param yVel Pointer to a double which will be incremented by the y-velocity at the target
+ */
+void meshVelocity(struct ParticleMesh *mesh, double x, double y, int selfIndex, double *xVel, double *yVel) {
+    int size = mesh->gridSize;
+    int gridX, gridY;
+    double fracX, fracY;
+    cloudInCell(mesh, x, y, &gridX, &gridY, &fracX, &fracY);
+
+    int nextX = (gridX + 1) % size, nextY = (gridY + 1) % size;
+    double complex velocity = mesh->grid[gridY * size + gridX] * (1 - fracX) * (1 - fracY)
+        + mesh->grid[gridY * size + nextX] * fracX * (1 - fracY)
+        + mesh->grid[nextY * size + gridX] * (1 - fracX) * fracY
+        + mesh->grid[nextY * size + nextX] * fracX * fracY;
+
+    *xVel += creal(velocity);
+    *yVel += cimag(velocity);
+
+    if (!mesh->shortRange) return;
+
+    double targetX = wrapCoordinate(x, DOMAIN_SIZE_X);
+    double targetY = wrapCoordinate(y, DOMAIN_SIZE_Y);
+    int cellX = (int)(targetX / DOMAIN_SIZE_X * mesh->cellsX);
+    int cellY = (int)(targetY / DOMAIN_SIZE_Y * mesh->cellsY);
+    if (cellX >= mesh->cellsX) cellX = mesh->cellsX - 1;
+    if (cellY >= mesh->cellsY) cellY = mesh->cellsY - 1;
+
+    // with fewer than 3 cells on a side the neighboring cells would repeat, so every cell on that side is searched once
+    int firstX = (mesh->cellsX >= 3) ? cellX - 1 : 0, lastX = (mesh->cellsX >= 3) ? cellX + 1 : mesh->cellsX - 1;
+    int firstY = (mesh->cellsY >= 3) ? cellY - 1 : 0, lastY = (mesh->cellsY >= 3) ? cellY + 1 : mesh->cellsY - 1;
+    double cutoffSquared = mesh->cutoff * mesh->cutoff;
+    double u = 0, v = 0;
+
+    for (int neighborY = firstY; neighborY <= lastY; neighborY++) {
+        for (int neighborX = firstX; neighborX <= lastX; neighborX++) {
+            int cell = wrapIndex(neighborY, mesh->cellsY) * mesh->cellsX + wrapIndex(neighborX, mesh->cellsX);
+
+            for (int i = mesh->cellStart[cell]; i < mesh->cellStart[cell + 1]; i++) {
+                if (mesh->sourceIndex[i] == selfIndex) continue;
+
+                // minimum image radius from the target to the source
+                double xRad = mesh->sourceX[i] - targetX;
+                double yRad = mesh->sourceY[i] - targetY;
+                xRad -= DOMAIN_SIZE_X * round(xRad / DOMAIN_SIZE_X);
+                yRad -= DOMAIN_SIZE_Y * round(yRad / DOMAIN_SIZE_Y);
+
+                double radSquared = xRad*xRad + yRad*yRad;
+                if (radSquared > cutoffSquared || radSquared == 0) continue;
+
+                double vmag = mesh->sourceGamma[i] / (2. * M_PI * radSquared) * exp(-radSquared / (2 * mesh->sigma * mesh->sigma));
+                u +=  yRad * vmag;
+                v += -xRad * vmag;
+            }
+        }
+    }
+
+    *xVel += u;
+    *yVel += v;
+}
@@ -0,0 +1,57 @@
+//
+//  particleMesh.h
+//  NBodySim
+//
+
+#ifndef particleMesh_h
+#define particleMesh_h
+
+#include <complex.h>
+
+#define P3M_SPLIT_CELLS 3 // width of the gaussian which splits the long and short range parts, in grid cells. The mesh error scales as (1/P3M_SPLIT_CELLS)^2
+#define P3M_CUTOFF_WIDTHS 5 // the short range part is truncated at this many gaussian widths
+
+/*
+ Particle-mesh solver for the doubly periodic point vortex velocity.
+
+ Vortex circulation is deposited onto a PM_GRID_SIZE x PM_GRID_SIZE periodic grid with cloud-in-cell weights, the
+ streamfunction is found from laplacian(psi) = -omega with an FFT, and the velocity u = dpsi/dy, v = -dpsi/dx is
+ interpolated back to the vortices and tracers with the same weights. The k = 0 mode is dropped, which is the same
+ uniform background vorticity as the exact periodic kernel in lattice.h, so there is no truncation radius.
+
+ With P3M_CORRECTION the vorticity is also smoothed by a gaussian of width sigma on the mesh, and the difference
+ between a point vortex and a gaussian blob,
+
+    |u| = gamma/(2*pi*r) * e^(-r^2 / (2*sigma^2))
+
+ is added directly for every pair closer than P3M_CUTOFF_WIDTHS * sigma, which restores the near field.
+ */
+struct ParticleMesh {
+    int gridSize;
+    double complex *grid; // vorticity, then u + iv at the grid points. Point (i, j) is at (i*spacingX, j*spacingY)
+    double spacingX;
+    double spacingY;
+
+    // P3M short range sources, wrapped into the domain and sorted into cells at least one cutoff wide
+    char shortRange;
+    double sigma;
+    double cutoff;
+    int cellsX;
+    int cellsY;
+    int cellsAllocated;
+    int *cellStart;
+    int *cellFill; // scratch space for sorting the sources into cells
+    int numSources;
+    int sourcesAllocated;
+    double *sourceX;
+    double *sourceY;
+    double *sourceGamma;
+    int *sourceIndex;
+    int *cellOf; // scratch space holding the cell of each source while they're sorted
+};
+
+void buildParticleMesh(struct ParticleMesh *mesh, const double *x, const double *y, const double *gamma, int numSources);
+void freeParticleMesh(struct ParticleMesh *mesh);
+void meshVelocity(struct ParticleMesh *mesh, double x, double y, int selfIndex, double *xVel, double *yVel);
+
+#endif /* particleMesh_h */
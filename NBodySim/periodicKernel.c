@@ -0,0 +1,186 @@
+//
+//  periodicKernel.c
+//  NBodySim
+//
+
+#include "periodicKernel.h"
+#include "lattice.h"
+#include "constants.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+
+#define KERNEL_CACHE_VERSION 2
+#define KERNEL_SERIES_POWER 64 // highest lattice sum used to build the table
+#define TABLE_PADDING 3 // one extra point below the domain and two above it, for the interpolation stencil
+
+struct KernelCacheHeader {
+    char magic[4];
+    int version;
+    int tableSize;
+    int seriesPower; // KERNEL_SERIES_POWER
+    int nearX; // near block of images summed directly, from chooseNearBlock()
+    int nearY;
+    int padding;
+    double width;
+    double height;
+};
+
+// A(z) at z = (i - 1 - KERNEL_TABLE_SIZE/2) * spacingX + (j - 1 - KERNEL_TABLE_SIZE/2) * spacingY * I, stored as table[j * rowLength + i]
+static double complex *kernelTable = NULL;
+static double conjugateCoefficient;
+static double spacingX;
+static double spacingY;
+static const int rowLength = KERNEL_TABLE_SIZE + TABLE_PADDING;
+
+/**
+ try to read the table from the cache file
+
+ @param nearX the near block the table would be built with
+ @param nearY
+ @return true if the cache exists and was built for the current domain, series and near block
+ */
+static char readKernelCache(int nearX, int nearY) {
+    FILE *cacheFile = fopen(KERNEL_CACHE_FILEPATH, "rb");
+    if (cacheFile == NULL) return 0;
+
+    struct KernelCacheHeader header;
+    long tableLength = (long)rowLength * rowLength;
+    char valid = fread(&header, sizeof(header), 1, cacheFile) == 1
+        && memcmp(header.magic, "NBKT", 4) == 0
+        && header.version == KERNEL_CACHE_VERSION
+        && header.tableSize == KERNEL_TABLE_SIZE
+        && header.seriesPower == KERNEL_SERIES_POWER
+        && header.nearX == nearX
+        && header.nearY == nearY
+        && header.width == DOMAIN_SIZE_X
+        && header.height == DOMAIN_SIZE_Y
+        && fread(&conjugateCoefficient, sizeof(double), 1, cacheFile) == 1
+        && fread(kernelTable, sizeof(double complex), tableLength, cacheFile) == tableLength;
+
+    fclose(cacheFile);
+    return valid;
+}
+
+static void writeKernelCache(int nearX, int nearY) {
+    FILE *cacheFile = fopen(KERNEL_CACHE_FILEPATH, "wb");
+    if (cacheFile == NULL) {
+        printf("Unable to write the periodic kernel cache to %s\n", KERNEL_CACHE_FILEPATH);
+        return;
+    }
+
+    struct KernelCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "NBKT", 4);
+    header.version = KERNEL_CACHE_VERSION;
+    header.tableSize = KERNEL_TABLE_SIZE;
+    header.seriesPower = KERNEL_SERIES_POWER;
+    header.nearX = nearX;
+    header.nearY = nearY;
+    header.width = DOMAIN_SIZE_X;
+    header.height = DOMAIN_SIZE_Y;
+
+    fwrite(&header, sizeof(header), 1, cacheFile);
+    fwrite(&conjugateCoefficient, sizeof(double), 1, cacheFile);
+    fwrite(kernelTable, sizeof(double complex), (long)rowLength * rowLength, cacheFile);
+    fclose(cacheFile);
+}
+
+/**
+ Load the kernel table for the current domain size from the cache, or compute it (and update the cache) if the
+ cached table is missing or was built for a different domain, lattice series or near block. Must be called after importConstants().
+ */
+void loadPeriodicKernel(void) {
+    spacingX = (double)DOMAIN_SIZE_X / KERNEL_TABLE_SIZE;
+    spacingY = (double)DOMAIN_SIZE_Y / KERNEL_TABLE_SIZE;
+
+    free(kernelTable);
+    kernelTable = malloc(sizeof(double complex) * rowLength * rowLength);
+    if (kernelTable == NULL) {
+        printf("Error allocating periodic kernel table");
+        exit(1);
+    }
+
+    int nearX, nearY;
+    chooseNearBlock(DOMAIN_SIZE_X, DOMAIN_SIZE_Y, &nearX, &nearY);
+    if (readKernelCache(nearX, nearY)) return;
+
+    printf("Computing periodic kernel table for a %ix%i domain\n", DOMAIN_SIZE_X, DOMAIN_SIZE_Y);
+
+    struct LatticeSums sums;
+    computeLatticeSums(&sums, DOMAIN_SIZE_X, DOMAIN_SIZE_Y, nearX, nearY, KERNEL_SERIES_POWER);
+
+    for (int j = 0; j < rowLength; j++) {
+        for (int i = 0; i < rowLength; i++) {
+            double complex z = (i - 1 - KERNEL_TABLE_SIZE/2) * spacingX + (j - 1 - KERNEL_TABLE_SIZE/2) * spacingY * I;
+            kernelTable[j * rowLength + i] = smoothKernel(&sums, z);
+        }
+    }
+    conjugateCoefficient = sums.conjugateCoefficient;
+    freeLatticeSums(&sums);
+
+    writeKernelCache(nearX, nearY);
+}
+
+void freePeriodicKernel(void) {
+    free(kernelTable);
+    kernelTable = NULL;
+}
+
+/**
+ weights of the 4 point Lagrange polynomial through -1, 0, 1, 2, evaluated at t
+ */
+static void lagrangeWeights(double t, double *weights) {
+    weights[0] = -t * (t - 1) * (t - 2) / 6;
+    weights[1] = (t + 1) * (t - 1) * (t - 2) / 2;
+    weights[2] = -(t + 1) * t * (t - 2) / 2;
+    weights[3] = (t + 1) * t * (t - 1) / 6;
+}
+
+/**
+ Calculate the velocity induced by a vortex and all of its periodic images, using the same radius convention as
+ calculateVel_vortex() and calculateVel_tracer().
+
+ @param xRad x-position of the vortex minus the x-position of the target
+ @param yRad y-position of the vortex minus the y-position of the target
+ @param gamma the intensity of the vortex
+ @param xVel Pointer to a double which will be incremented by the x-velocity at the target
+ @param yVel Pointer to a double which will be incremented by the y-velocity at the target
+ */
+void periodicKernelVelocity(double xRad, double yRad, double gamma, double *xVel, double *yVel) {
+    // minimum image separation of the target from the vortex
+    double dx = -xRad - DOMAIN_SIZE_X * round(-xRad / DOMAIN_SIZE_X);
+    double dy = -yRad - DOMAIN_SIZE_Y * round(-yRad / DOMAIN_SIZE_Y);
+    if (dx == 0 && dy == 0) return;
+
+    double u = dx / spacingX + KERNEL_TABLE_SIZE/2;
+    double v = dy / spacingY + KERNEL_TABLE_SIZE/2;
+    int cellX = (int)floor(u);
+    int cellY = (int)floor(v);
+    if (cellX > KERNEL_TABLE_SIZE - 1) cellX = KERNEL_TABLE_SIZE - 1;
+    if (cellY > KERNEL_TABLE_SIZE - 1) cellY = KERNEL_TABLE_SIZE - 1;
+    if (cellX < 0) cellX = 0;
+    if (cellY < 0) cellY = 0;
+
+    double weightsX[4], weightsY[4];
+    lagrangeWeights(u - cellX, weightsX);
+    lagrangeWeights(v - cellY, weightsY);
+
+    // padded index p holds grid point p - 1, so the stencil cellX - 1 to cellX + 2 starts at padded index cellX
+    const double complex *corner = &kernelTable[cellY * rowLength + cellX];
+    double complex smooth = 0;
+    for (int j = 0; j < 4; j++) {
+        double complex row = 0;
+        for (int i = 0; i < 4; i++) row += weightsX[i] * corner[j * rowLength + i];
+        smooth += weightsY[j] * row;
+    }
+
+    double complex z = dx + dy * I;
+    double complex w = gamma * (1. / z + smooth + conjugateCoefficient * conj(z));
+
+    // u - iv = w / (2*pi*i)
+    *xVel += cimag(w) / (2 * M_PI);
+    *yVel += creal(w) / (2 * M_PI);
+}
@@ -0,0 +1,30 @@
+//
+//  periodicKernel.h
+//  NBodySim
+//
+
+#ifndef periodicKernel_h
+#define periodicKernel_h
+
+#define KERNEL_TABLE_SIZE 256 // table points per side of the domain
+#define KERNEL_CACHE_FILEPATH "./data/kernelCache"
+
+/*
+ Tabulated doubly periodic point vortex kernel, used by the direct solver when PERIODIC_KERNEL is set.
+
+ The velocity induced by a vortex and all of its periodic images is (see lattice.h)
+
+    u - iv = gamma/(2*pi*i) * (1/z + A(z) + b*conj(z))
+
+ where z is the minimum image separation and A is analytic over the whole domain. A is tabulated once per domain
+ size on a KERNEL_TABLE_SIZE^2 grid and interpolated with bicubic Lagrange polynomials, so each pair costs one
+ table lookup instead of 9 images, and there is no truncation radius. Because A is smooth the interpolation error
+ is far below the error of the time integration. The table is cached on disk, and only recomputed if the domain
+ size or table size has changed.
+ */
+
+void loadPeriodicKernel(void);
+void freePeriodicKernel(void);
+void periodicKernelVelocity(double xRad, double yRad, double gamma, double *xVel, double *yVel);
+
+#endif /* periodicKernel_h */
@@ -0,0 +1,273 @@
+//
+//  quadtree.c
+//  NBodySim
+//
+
+#include "quadtree.h"
+#include "constants.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define TREE_MAX_DEPTH 48 // stops subdivision when many vortices sit on top of eachother
+
+/*
+ Barnes-Hut style tree code for the vortex <-> vortex and vortex <-> tracer velocities.
+
+ The tree is built over the vortex positions, and every cell stores the moments of a complex
+ multipole expansion about its geometric center. For a target at z, a cell which is far enough
+ away (cellSize / distance < theta) contributes
+
+    u - iv = 1/(2*pi*i) * sum_k M_k / (z - center)^(k+1)
+
+ instead of one term per vortex in the cell. Cells which are too close are opened, and leaves
+ are summed directly, so the error is controlled entirely by theta.
+ */
+
+/**
+ make sure that the node array has room for at least one more node
+
+ @return the index of the new node
+ */
+static int allocateNode(struct QuadTree *tree) {
+    if (tree->numNodes >= tree->nodesAllocated) {
+        tree->nodesAllocated = (tree->nodesAllocated) ? tree->nodesAllocated * 2 : 64;
+        tree->nodes = countedRealloc(tree->nodes, sizeof(struct QuadNode) * tree->nodesAllocated);
+        if (tree->nodes == NULL) {
+            printf("Error reallocating quadtree nodes");
+            exit(1);
+        }
+    }
+    return tree->numNodes++;
+}
+
+/**
+ reorder bodies[first, first + count) so that every body with a coordinate below split comes first
+
+ @return the number of bodies below split
+ */
+static int partitionBodies(struct QuadTree *tree, int first, int count, char useY, double split) {
+    const double *coords = (useY) ? tree->y : tree->x;
+    int *bodies = &tree->bodies[first];
+    int low = 0;
+    int high = count - 1;
+
+    while (low <= high) {
+        if (coords[bodies[low]] < split) {
+            low++;
+        } else {
+            int temp = bodies[low];
+            bodies[low] = bodies[high];
+            bodies[high--] = temp;
+        }
+    }
+    return low;
+}
+
+/**
+ recursively build the cell covering bodies[first, first + count)
+
+ @return the index of the new cell in the node array
+ */
+static int buildNode(struct QuadTree *tree, int first, int count, double centerX, double centerY, double halfWidth, double halfHeight, int depth) {
+    int nodeIndex = allocateNode(tree);
+    struct QuadNode *node = &tree->nodes[nodeIndex];
+
+    node->centerX = centerX;
+    node->centerY = centerY;
+    node->halfWidth = halfWidth;
+    node->halfHeight = halfHeight;
+    node->radius = sqrt(halfWidth * halfWidth + halfHeight * halfHeight);
+    node->firstBody = first;
+    node->numBodies = count;
+    node->isLeaf = (count <= TREE_LEAF_SIZE || depth >= TREE_MAX_DEPTH);
+    for (int quadrant = 0; quadrant < 4; quadrant++) node->children[quadrant] = -1;
+    for (int k = 0; k <= TREE_ORDER; k++) node->moments[k] = 0;
+
+    if (node->isLeaf) {
+        for (int i = first; i < first + count; i++) {
+            int body = tree->bodies[i];
+            double complex offset = (tree->x[body] - centerX) + (tree->y[body] - centerY) * I;
+            double complex power = tree->gamma[body];
+            for (int k = 0; k <= TREE_ORDER; k++) {
+                node->moments[k] += power;
+                power *= offset;
+            }
+        }
+        return nodeIndex;
+    }
+
+    /* quadrant numbering scheme:
+       2 3
+       0 1
+       */
+    int bottomCount = partitionBodies(tree, first, count, 1, centerY);
+    int bottomLeftCount = partitionBodies(tree, first, bottomCount, 0, centerX);
+    int topLeftCount = partitionBodies(tree, first + bottomCount, count - bottomCount, 0, centerX);
+
+    int quadrantFirst[4] = {first, first + bottomLeftCount, first + bottomCount, first + bottomCount + topLeftCount};
+    int quadrantCount[4] = {bottomLeftCount, bottomCount - bottomLeftCount, topLeftCount, count - bottomCount - topLeftCount};
+
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        if (quadrantCount[quadrant] == 0) continue;
+
+        double childX = centerX + ((quadrant & 1) ? halfWidth/2 : -halfWidth/2);
+        double childY = centerY + ((quadrant & 2) ? halfHeight/2 : -halfHeight/2);
+        int childIndex = buildNode(tree, quadrantFirst[quadrant], quadrantCount[quadrant], childX, childY, halfWidth/2, halfHeight/2, depth + 1);
+
+        // buildNode can realloc the node array, so the node pointers have to be looked up again
+        node = &tree->nodes[nodeIndex];
+        struct QuadNode *child = &tree->nodes[childIndex];
+        node->children[quadrant] = childIndex;
+
+        // shift the child's expansion to this cell's center: (d + t)^k = sum_m C(k,m) d^m t^(k-m)
+        double complex shift = (child->centerX - centerX) + (child->centerY - centerY) * I;
+        double complex shiftPowers[TREE_ORDER + 1];
+        shiftPowers[0] = 1;
+        for (int k = 1; k <= TREE_ORDER; k++) shiftPowers[k] = shiftPowers[k-1] * shift;
+
+        for (int k = 0; k <= TREE_ORDER; k++) {
+            double binomial = 1;
+            for (int m = k; m >= 0; m--) {
+                node->moments[k] += binomial * shiftPowers[k-m] * child->moments[m];
+                binomial = binomial * m / (k - m + 1);
+            }
+        }
+    }
+
+    return nodeIndex;
+}
+
+/**
+ Build a quadtree over a set of point vortices. The arrays are not copied, so they must stay valid until the tree is no longer used.
+
+ @param tree the tree to (re)build. Memory from a previous build is reused
+ @param x array of vortex x-positions
+ @param y array of vortex y-positions
+ @param gamma array of vortex intensities
+ @param numSources the length of the x, y and gamma arrays
+ */
+void buildQuadTree(struct QuadTree *tree, const double *x, const double *y, const double *gamma, int numSources) {
+    tree->x = x;
+    tree->y = y;
+    tree->gamma = gamma;
+    tree->numSources = numSources;
+    tree->numNodes = 0;
+
+    if (numSources > tree->bodiesAllocated) {
+        tree->bodiesAllocated = numSources * 1.5;
+        tree->bodies = countedRealloc(tree->bodies, sizeof(int) * tree->bodiesAllocated);
+        if (tree->bodies == NULL) {
+            printf("Error reallocating quadtree bodies");
+            exit(1);
+        }
+    }
+
+    if (numSources == 0) return;
+
+    // vortices aren't always inside the driver domain between wraps, so the root cell is fit to the vortices
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i = 0; i < numSources; i++) {
+        tree->bodies[i] = i;
+        if (x[i] < minX) minX = x[i];
+        if (x[i] > maxX) maxX = x[i];
+        if (y[i] < minY) minY = y[i];
+        if (y[i] > maxY) maxY = y[i];
+    }
+
+    // pad the root slightly so that no vortex sits exactly on its upper edges
+    double halfWidth = (maxX - minX) / 2 * 1.0001 + 1e-9;
+    double halfHeight = (maxY - minY) / 2 * 1.0001 + 1e-9;
+
+    buildNode(tree, 0, numSources, (minX + maxX) / 2, (minY + maxY) / 2, halfWidth, halfHeight, 0);
+}
+
+void freeQuadTree(struct QuadTree *tree) {
+    free(tree->nodes);
+    free(tree->bodies);
+    tree->nodes = NULL;
+    tree->bodies = NULL;
+    tree->numNodes = tree->nodesAllocated = tree->bodiesAllocated = 0;
+}
+
+/**
+ Calculate the velocity induced at a point by every vortex in the tree. Pairs further apart than cutoff are ignored,
+ which matches the domain truncation used by calculateVel_vortex() and calculateVel_tracer().
+
+ @param tree a tree built by buildQuadTree()
+ @param x the x-position of the target
+ @param y the y-position of the target
+ @param selfIndex the source index of the target if it is one of the vortices in the tree, otherwise -1
+ @param theta the opening angle. Cells with size/distance < theta are approximated by their multipole expansion
+ @param cutoff interactions with a radius larger than this are skipped
+ @param periodic if true, the 8 periodic images of the driver domain are included
+ @param xVel Pointer to a double which will be incremented by the x-velocity at the target
+ @param yVel Pointer to a double which will be incremented by the y-velocity at the target
+ */
+void treeVelocity(struct QuadTree *tree, double x, double y, int selfIndex, double theta, double cutoff, char periodic, double *xVel, double *yVel) {
+    if (tree->numNodes == 0) return;
+
+    int stack[TREE_MAX_DEPTH * 4 + 4];
+    double complex farField = 0; // sum of gamma / (z - z_j) from every multipole approximation
+    double u = 0, v = 0;
+
+    for (int imageX = -1; imageX <= 1; imageX++) {
+        for (int imageY = -1; imageY <= 1; imageY++) {
+            if (!periodic && (imageX || imageY)) continue;
+
+            // shifting the target by -offset is the same as shifting every source by +offset
+            double targetX = x - imageX * DOMAIN_SIZE_X;
+            double targetY = y - imageY * DOMAIN_SIZE_Y;
+
+            int stackSize = 0;
+            stack[stackSize++] = 0;
+
+            while (stackSize) {
+                struct QuadNode *node = &tree->nodes[stack[--stackSize]];
+                double dx = targetX - node->centerX;
+                double dy = targetY - node->centerY;
+                double dist = sqrt(dx*dx + dy*dy);
+
+                if (dist - node->radius > cutoff) continue; // every vortex in the cell is truncated
+
+                double size = 2 * fmax(node->halfWidth, node->halfHeight);
+                if (!node->isLeaf && size < theta * dist && dist + node->radius <= cutoff) {
+                    double complex inverse = 1. / (dx + dy * I);
+                    double complex power = inverse;
+                    for (int k = 0; k <= TREE_ORDER; k++) {
+                        farField += node->moments[k] * power;
+                        power *= inverse;
+                    }
+                    continue;
+                }
+
+                if (node->isLeaf) {
+                    for (int i = node->firstBody; i < node->firstBody + node->numBodies; i++) {
+                        int body = tree->bodies[i];
+                        if (body == selfIndex) continue;
+
+                        double xRad = tree->x[body] - targetX;
+                        double yRad = tree->y[body] - targetY;
+                        double rad = sqrt(xRad*xRad + yRad*yRad);
+                        if (rad > cutoff || rad == 0) continue;
+
+                        double vmag = tree->gamma[body] / (2.*M_PI*rad);
+                        u +=  (yRad/rad) * vmag;
+                        v += (-xRad/rad) * vmag;
+                    }
+                    continue;
+                }
+
+                for (int quadrant = 0; quadrant < 4; quadrant++) {
+                    if (node->children[quadrant] >= 0) stack[stackSize++] = node->children[quadrant];
+                }
+            }
+        }
+    }
+
+    // u - iv = farField / (2*pi*i)
+    double complex w = farField / (2. * M_PI * I);
+    *xVel += u + creal(w);
+    *yVel += v - cimag(w);
+}
@@ -0,0 +1,47 @@
+//
+//  quadtree.h
+//  NBodySim
+//
+
+#ifndef quadtree_h
+#define quadtree_h
+
+#include <complex.h>
+
+#define TREE_ORDER 10 // highest power kept in each cell's multipole expansion
+#define TREE_LEAF_SIZE 8 // cells holding this many vortices or fewer are not subdivided
+
+struct QuadNode {
+    double centerX;
+    double centerY;
+    double halfWidth;
+    double halfHeight;
+    double radius; // distance from the center of the cell to its corners
+
+    int children[4]; // indices into the tree's node array, -1 if the quadrant is empty
+    int isLeaf;
+    int firstBody; // this cell's vortices are bodies[firstBody] to bodies[firstBody + numBodies - 1]
+    int numBodies;
+
+    double complex moments[TREE_ORDER + 1]; // M_k = sum of gamma_j * (z_j - center)^k
+};
+
+struct QuadTree {
+    struct QuadNode *nodes;
+    int numNodes;
+    int nodesAllocated;
+
+    int *bodies; // source indices, ordered so that every cell's sources are contiguous
+    int bodiesAllocated;
+
+    const double *x;
+    const double *y;
+    const double *gamma;
+    int numSources;
+};
+
+void buildQuadTree(struct QuadTree *tree, const double *x, const double *y, const double *gamma, int numSources);
+void freeQuadTree(struct QuadTree *tree);
+void treeVelocity(struct QuadTree *tree, double x, double y, int selfIndex, double theta, double cutoff, char periodic, double *xVel, double *yVel);
+
+#endif /* quadtree_h */
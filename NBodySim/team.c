@@ -0,0 +1,396 @@
+//
+//  team.c
+//  NBodySim
+//
+
+#include "team.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+static int size = 1;
+static int spinCount = TEAM_SPIN_COUNT; // 0 if there are more threads than CPUs, since a spinning thread would only hold up the thread it waits for
+static pthread_t *threads = NULL;
+
+// the region the workers run next, or NULL to make them exit
+static TeamRegion currentRegion = NULL;
+static void *currentContext = NULL;
+
+static pthread_mutex_t barrierMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t barrierCondition = PTHREAD_COND_INITIALIZER;
+static int barrierCount = 0;
+static int barrierGeneration = 0;
+
+// A Chase-Lev deque. Only the owner touches bottom, and thieves race each other and the owner's last pop with a CAS on top
+struct TaskDeque {
+    long top;
+    long bottom;
+    struct Task *tasks[TASK_DEQUE_SIZE];
+} __attribute__((aligned(64)));
+
+static struct TaskDeque *deques = NULL; // one per member
+static long loopsFinished = 0; // members which have finished their part of a parallelFor(), over every call so far
+
+static _Thread_local int myRank = 0;
+static _Thread_local char inRegion = 0;
+static _Thread_local long loopsStarted = 0;
+static _Thread_local unsigned int stealSeed = 1;
+
+static inline void cpuRelax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ called by a thread which is waiting for work to show up in someone else's deque
+ */
+static inline void idle(void) {
+    if (spinCount) {
+        cpuRelax();
+    } else {
+        sched_yield(); // the thread with the work might be waiting for this CPU
+    }
+}
+
+/**
+ Wait until every member of the team has reached the barrier. Everything written before the barrier is visible to every member after it.
+ */
+void teamBarrier(void) {
+    if (size == 1) return;
+
+    int generation = __atomic_load_n(&barrierGeneration, __ATOMIC_ACQUIRE);
+    if (__atomic_add_fetch(&barrierCount, 1, __ATOMIC_ACQ_REL) == size) {
+        // last one in. Nobody can leave until the generation changes, so the count can be reset first
+        __atomic_store_n(&barrierCount, 0, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&barrierMutex);
+        __atomic_store_n(&barrierGeneration, generation + 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&barrierCondition);
+        pthread_mutex_unlock(&barrierMutex);
+        return;
+    }
+
+    for (int spin = 0; spin < spinCount; spin++) {
+        if (__atomic_load_n(&barrierGeneration, __ATOMIC_ACQUIRE) != generation) return;
+        cpuRelax();
+    }
+
+    pthread_mutex_lock(&barrierMutex);
+    while (__atomic_load_n(&barrierGeneration, __ATOMIC_ACQUIRE) == generation) {
+        pthread_cond_wait(&barrierCondition, &barrierMutex);
+    }
+    pthread_mutex_unlock(&barrierMutex);
+}
+
+/**
+ the loop run by every member except rank 0. The barrier at the start of a region waits for runTeamRegion() to be called, and the barrier
+ at the end lets runTeamRegion() return.
+ */
+static void *teamWorker(void *argument) {
+    int rank = (int)(long)argument;
+    myRank = rank;
+    stealSeed = rank + 1;
+
+    while (1) {
+        teamBarrier();
+        if (currentRegion == NULL) break;
+
+        inRegion = 1;
+        currentRegion(rank, currentContext);
+        inRegion = 0;
+        teamBarrier();
+    }
+    return NULL;
+}
+
+/**
+ start the team
+
+ @param teamSize the number of threads in the team, including the thread which calls runTeamRegion()
+ */
+void initTeam(int teamSize) {
+    size = (teamSize > 1) ? teamSize : 1;
+
+    deques = aligned_alloc(64, sizeof(struct TaskDeque) * size);
+    if (deques == NULL) {
+        printf("Error allocating task deques");
+        exit(1);
+    }
+    for (int rank = 0; rank < size; rank++) deques[rank].top = deques[rank].bottom = 0;
+
+    if (size == 1) return;
+
+    long numCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+    spinCount = (numCPUs > 0 && size > numCPUs) ? 0 : TEAM_SPIN_COUNT;
+
+    threads = malloc(sizeof(pthread_t) * size);
+    for (int rank = 1; rank < size; rank++) {
+        if (pthread_create(&threads[rank], NULL, teamWorker, (void *)(long)rank)) {
+            printf("Error starting team thread %i", rank);
+            exit(1);
+        }
+    }
+}
+
+/**
+ stop the team. Has to be called from the thread which called initTeam()
+ */
+void freeTeam(void) {
+    if (size > 1) {
+        currentRegion = NULL;
+        teamBarrier();
+        for (int rank = 1; rank < size; rank++) pthread_join(threads[rank], NULL);
+        free(threads);
+        threads = NULL;
+    }
+    free(deques);
+    deques = NULL;
+    size = 1;
+
+    // parallelFor() counts calls from the start of the team, so a new team has to start counting again
+    loopsFinished = 0;
+    loopsStarted = 0;
+}
+
+int teamSize(void) {
+    return size;
+}
+
+/**
+ Run a function on every member of the team, and wait for all of them to finish
+
+ @param region the function to run. It is passed the rank of the member running it, from 0 to teamSize() - 1
+ @param context passed to every call of region
+ */
+void runTeamRegion(TeamRegion region, void *context) {
+    currentRegion = region;
+    currentContext = context;
+
+    teamBarrier();
+    inRegion = 1;
+    region(0, context);
+    inRegion = 0;
+    teamBarrier();
+}
+
+/**
+ Find the block of [0, n) owned by one member of the team. The blocks are contiguous, in rank order, and cover every item.
+
+ @param n the number of items to split up
+ @param rank the member to find the block of
+ @param triangular true if the work for item i is proportional to i, like the rows of the vortex radii triangle. The blocks are then split by area instead of by length
+ @param first set to the first item in the block
+ @param last set to one past the last item in the block
+ */
+void teamBlock(int n, int rank, char triangular, int *first, int *last) {
+    if (triangular) {
+        *first = (rank == 0) ? 0 : (int)(n * sqrt((double)rank / size));
+        *last = (rank == size - 1) ? n : (int)(n * sqrt((double)(rank + 1) / size));
+    } else {
+        *first = (int)((long)n * rank / size);
+        *last = (int)((long)n * (rank + 1) / size);
+    }
+}
+
+#pragma mark - Work Stealing
+
+/**
+ push a task onto the bottom of the calling member's deque
+
+ @return false if the deque is full
+ */
+static char pushTask(struct Task *task) {
+    struct TaskDeque *deque = &deques[myRank];
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= TASK_DEQUE_SIZE) return 0;
+
+    __atomic_store_n(&deque->tasks[bottom & (TASK_DEQUE_SIZE - 1)], task, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE); // publishes the task, and everything the spawner wrote before it
+    return 1;
+}
+
+/**
+ take the newest task from the bottom of the calling member's deque
+
+ @return the task, or NULL if the deque is empty
+ */
+static struct Task *popTask(void) {
+    struct TaskDeque *deque = &deques[myRank];
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) { // empty
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    struct Task *task = __atomic_load_n(&deque->tasks[bottom & (TASK_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (top == bottom) {
+        // the last task, which a thief might be taking at the same time
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) task = NULL;
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+/**
+ take the oldest task from the top of another member's deque. Victims are tried in a random order, starting from a different one
+ on every call, so that thieves don't all pile onto the same member
+
+ @return the task, or NULL if nothing was stolen
+ */
+static struct Task *stealTask(void) {
+    stealSeed ^= stealSeed << 13;
+    stealSeed ^= stealSeed >> 17;
+    stealSeed ^= stealSeed << 5;
+
+    for (int attempt = 0; attempt < size; attempt++) {
+        int victim = (stealSeed + attempt) % size;
+        if (victim == myRank) continue;
+
+        struct TaskDeque *deque = &deques[victim];
+        long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+        if (top >= bottom) continue;
+
+        struct Task *task = __atomic_load_n(&deque->tasks[top & (TASK_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) return task;
+    }
+    return NULL;
+}
+
+static void runTask(struct Task *task) {
+    task->function(task->argument);
+    __atomic_sub_fetch(&task->group->pending, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ Start a task which can run at the same time as the rest of the caller's work. It runs on the calling thread when it gets to it in
+ syncTasks(), unless another member of the team steals it first. Outside of a region, nobody is stealing, so the task always ends up
+ running on the calling thread.
+
+ @param group the group to add the task to. The caller has to wait on it with syncTasks()
+ @param task storage for the task, which must stay valid until the group is synced
+ @param function the function to run
+ @param argument passed to the function
+ */
+void spawnTask(struct TaskGroup *group, struct Task *task, TaskFunction function, void *argument) {
+    task->function = function;
+    task->argument = argument;
+    task->group = group;
+
+    __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+    if (!pushTask(task)) runTask(task); // too many tasks are already waiting, so this one may as well run now
+}
+
+/**
+ Wait for every task in a group to finish. The calling thread runs its own tasks, and steals from the rest of the team while the
+ tasks it spawned are being run by somebody else.
+ */
+void syncTasks(struct TaskGroup *group) {
+    while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+        struct Task *task = popTask();
+        if (task == NULL) task = stealTask();
+
+        if (task) {
+            runTask(task);
+        } else {
+            idle();
+        }
+    }
+}
+
+struct RangeTask {
+    struct Task task;
+    int first;
+    int last;
+    int grain;
+    RangeFunction body;
+    void *context;
+};
+
+static void splitRange(struct RangeTask *range);
+
+static void runRangeTask(void *argument) {
+    splitRange(argument);
+}
+
+/**
+ run body over a range by splitting it in half until the pieces are no bigger than the grain size. The upper half is spawned, so
+ the biggest pieces are the ones left at the top of the deque for thieves
+ */
+static void splitRange(struct RangeTask *range) {
+    if (range->last - range->first <= range->grain) {
+        if (range->last > range->first) range->body(range->first, range->last, range->context);
+        return;
+    }
+
+    int middle = range->first + (range->last - range->first) / 2;
+    struct TaskGroup group = {0};
+
+    struct RangeTask upper = *range;
+    upper.first = middle;
+    spawnTask(&group, &upper.task, runRangeTask, &upper);
+
+    struct RangeTask lower = *range;
+    lower.last = middle;
+    splitRange(&lower);
+
+    syncTasks(&group);
+}
+
+static void parallelForRegion(int rank, void *context) {
+    struct RangeTask *range = context;
+    parallelFor(range->first, range->last, range->grain, range->body, range->context);
+}
+
+/**
+ Run body over every index in [first, last), split into pieces of at most grain indices which are load balanced across the team
+ by work stealing. Each member starts on its own block of the range, as given by teamBlock(), so that members work on the same
+ data from call to call, and then steals from the others once it has run out.
+
+ Inside of a region this is a collective, like teamBarrier(). Every member has to call it with the same arguments, and it returns
+ once the whole range is done. Outside of a region it runs a region of its own. It can't be called from inside a task.
+
+ @param first the first index
+ @param last one past the last index
+ @param grain the largest number of indices passed to one call of body. This should be big enough that each call does a few
+    microseconds of work
+ @param body called with a piece of the range [first, last) and context
+ @param context passed to every call of body. Inside of a region, stolen pieces are run with the context of the member they were
+    stolen from, so every member's context has to hold the same values
+ */
+void parallelFor(int first, int last, int grain, RangeFunction body, void *context) {
+    struct RangeTask range = {.first = first, .last = last, .grain = (grain > 0) ? grain : 1, .body = body, .context = context};
+
+    if (!inRegion && size > 1) {
+        runTeamRegion(parallelForRegion, &range);
+        return;
+    }
+
+    int blockFirst, blockLast;
+    teamBlock(last - first, myRank, 0, &blockFirst, &blockLast);
+    range.first = first + blockFirst;
+    range.last = first + blockLast;
+    splitRange(&range);
+
+    // help out with whatever is left of the other members' blocks. Every member makes the same sequence of calls, so the number
+    // of members which have finished every call up to this one is known without resetting anything
+    long target = ++loopsStarted * size;
+    __atomic_add_fetch(&loopsFinished, 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&loopsFinished, __ATOMIC_ACQUIRE) < target) {
+        struct Task *task = stealTask();
+        if (task) {
+            runTask(task);
+        } else {
+            idle();
+        }
+    }
+}
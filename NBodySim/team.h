@@ -0,0 +1,54 @@
+//
+//  team.h
+//  NBodySim
+//
+
+#ifndef team_h
+#define team_h
+
+#define TEAM_SPIN_COUNT 4000 // how many times a thread checks a barrier before it goes to sleep
+#define TASK_DEQUE_SIZE 256 // tasks each member can have waiting at once, must be a power of 2. Tasks spawned past this run right away
+
+/*
+ A persistent team of worker threads for SPMD parallel regions, with a work stealing scheduler for uneven work.
+
+ runTeamRegion() runs the same function on every member of the team at once, with the calling thread as rank 0.
+ Inside of a region, the members split the work with teamBlock() and synchronise with teamBarrier(). This lets a
+ whole timestep run as one region instead of submitting and waiting on jobs for every stage. The barrier spins
+ for a short time before sleeping, so short phases don't pay for a trip through the scheduler, and idle threads
+ don't burn CPU time between regions.
+
+ Work whose cost isn't known ahead of time, like tree traversals or scanning the radii triangle for merges, goes
+ through parallelFor() or spawnTask()/syncTasks() instead. Every member has a Chase-Lev deque of tasks. A member
+ pushes and pops tasks at the bottom of its own deque without taking a lock, and a member with nothing left to do
+ steals from the top of someone else's, which is where the biggest pieces of a recursively split range are. Tasks
+ and their groups are stored by whoever spawns them, usually on the stack, so nothing is allocated per task.
+ */
+
+typedef void (*TeamRegion)(int rank, void *context);
+typedef void (*TaskFunction)(void *argument);
+typedef void (*RangeFunction)(int first, int last, void *context);
+
+// a set of spawned tasks which can be waited on together
+struct TaskGroup {
+    int pending; // tasks spawned into the group which haven't finished
+};
+
+struct Task {
+    TaskFunction function;
+    void *argument;
+    struct TaskGroup *group;
+};
+
+void initTeam(int size);
+void freeTeam(void);
+int teamSize(void);
+void runTeamRegion(TeamRegion region, void *context);
+void teamBarrier(void);
+void teamBlock(int n, int rank, char triangular, int *first, int *last);
+
+void spawnTask(struct TaskGroup *group, struct Task *task, TaskFunction function, void *argument);
+void syncTasks(struct TaskGroup *group);
+void parallelFor(int first, int last, int grain, RangeFunction body, void *context);
+
+#endif /* team_h */
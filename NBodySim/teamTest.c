@@ -0,0 +1,246 @@
+//
+//  teamTest.c
+//  NBodySim
+//
+//  Stress test for team.c. Every team size given on the command line is started in turn, and the regions, barriers, tasks and
+//  parallel loops are run over and over, checking that every member, task and index runs exactly once. Run by test.sh.
+//
+
+#include "team.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPEATS 200
+#define RANGE_SIZE 100003 // prime, so the blocks and halves don't split evenly
+#define BARRIER_PHASES 50
+#define TASK_TREE_DEPTH 12 // each member spawns 2^depth leaf tasks
+#define FLAT_TASKS (TASK_DEQUE_SIZE * 4) // spawned into one group, enough to fill the deque
+
+static int failures = 0;
+static int *runCounts = NULL; // how many times each index has been run
+
+static void fail(const char *test, int size, const char *message, long value) {
+    printf("FAIL %s with %i threads: %s %li\n", test, size, message, value);
+    failures++;
+}
+
+/**
+ check that every index in [0, n) ran exactly once, then clear the counts
+ */
+static void checkRunCounts(const char *test, int n) {
+    for (int i = 0; i < n; i++) {
+        if (runCounts[i] != 1) {
+            fail(test, teamSize(), "ran this many times:", runCounts[i]);
+            printf("    index %i\n", i);
+            break;
+        }
+    }
+    memset(runCounts, 0, sizeof(int) * n);
+}
+
+static void countRange(int first, int last, void *context) {
+    int offset = *(int *)context;
+    for (int i = first; i < last; i++) __atomic_add_fetch(&runCounts[i - offset], 1, __ATOMIC_RELAXED);
+}
+
+#pragma mark - Blocks
+
+static void testTeamBlock(void) {
+    int sizes[] = {0, 1, 7, 100, RANGE_SIZE};
+    for (int triangular = 0; triangular <= 1; triangular++) {
+        for (int s = 0; s < (int)(sizeof(sizes) / sizeof(sizes[0])); s++) {
+            int expectedFirst = 0;
+            for (int rank = 0; rank < teamSize(); rank++) {
+                int first, last;
+                teamBlock(sizes[s], rank, triangular, &first, &last);
+                if (first != expectedFirst || last < first) fail("teamBlock", teamSize(), "gap or overlap at rank", rank);
+                expectedFirst = last;
+            }
+            if (expectedFirst != sizes[s]) fail("teamBlock", teamSize(), "blocks end before n, at", expectedFirst);
+        }
+    }
+}
+
+#pragma mark - Regions and Barriers
+
+struct BarrierTest {
+    int ranksRun[64];
+    int arrived[BARRIER_PHASES];
+    int late; // members which saw a phase before everyone had arrived at it
+};
+
+static void barrierRegion(int rank, void *context) {
+    struct BarrierTest *test = context;
+    __atomic_add_fetch(&test->ranksRun[rank], 1, __ATOMIC_RELAXED);
+    for (int phase = 0; phase < BARRIER_PHASES; phase++) {
+        __atomic_add_fetch(&test->arrived[phase], 1, __ATOMIC_RELAXED);
+        teamBarrier();
+        if (__atomic_load_n(&test->arrived[phase], __ATOMIC_RELAXED) != teamSize()) __atomic_add_fetch(&test->late, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void testRegions(void) {
+    for (int repeat = 0; repeat < REPEATS / 10; repeat++) {
+        struct BarrierTest test = {0};
+        runTeamRegion(barrierRegion, &test);
+        for (int rank = 0; rank < teamSize(); rank++) {
+            if (test.ranksRun[rank] != 1) fail("runTeamRegion", teamSize(), "rank didn't run exactly once:", rank);
+        }
+        if (test.late) fail("teamBarrier", teamSize(), "members let through early:", test.late);
+    }
+}
+
+#pragma mark - Tasks
+
+struct TreeTask {
+    int first;
+    int last;
+};
+
+/**
+ mark [first, last) by splitting it in two and spawning one half, down to single indices
+ */
+static void runTreeTask(void *argument) {
+    struct TreeTask *range = argument;
+    if (range->last - range->first == 1) {
+        __atomic_add_fetch(&runCounts[range->first], 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    int middle = range->first + (range->last - range->first) / 2;
+    struct TreeTask lower = {range->first, middle};
+    struct TreeTask upper = {middle, range->last};
+    struct TaskGroup group = {0};
+    struct Task task;
+    spawnTask(&group, &task, runTreeTask, &upper);
+    runTreeTask(&lower);
+    syncTasks(&group);
+}
+
+static void markIndex(void *argument) {
+    __atomic_add_fetch(&runCounts[*(int *)argument], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ spawn more tasks into one group than the deque holds, so some of them run straight away
+ */
+static void spawnFlat(int offset) {
+    static _Thread_local struct Task tasks[FLAT_TASKS];
+    static _Thread_local int indices[FLAT_TASKS];
+    struct TaskGroup group = {0};
+    for (int i = 0; i < FLAT_TASKS; i++) {
+        indices[i] = offset + i;
+        spawnTask(&group, &tasks[i], markIndex, &indices[i]);
+    }
+    syncTasks(&group);
+}
+
+static void taskRegion(int rank, void *context) {
+    int leaves = 1 << TASK_TREE_DEPTH;
+    struct TreeTask range = {rank * leaves, (rank + 1) * leaves};
+    runTreeTask(&range);
+    teamBarrier();
+    if (rank == 0) checkRunCounts("spawnTask/syncTasks", teamSize() * leaves);
+    teamBarrier();
+
+    spawnFlat(rank * FLAT_TASKS);
+    teamBarrier();
+    if (rank == 0) checkRunCounts("spawnTask past a full deque", teamSize() * FLAT_TASKS);
+}
+
+static void testTasks(void) {
+    for (int repeat = 0; repeat < REPEATS / 10; repeat++) runTeamRegion(taskRegion, NULL);
+
+    // outside of a region, every task runs on the calling thread
+    int leaves = 1 << TASK_TREE_DEPTH;
+    struct TreeTask range = {0, leaves};
+    runTreeTask(&range);
+    checkRunCounts("spawnTask/syncTasks outside of a region", leaves);
+}
+
+#pragma mark - Parallel Loops
+
+struct LoopTest {
+    int offset;
+    int early; // members which returned from parallelFor() before the whole range was done
+};
+
+static void loopRegion(int rank, void *context) {
+    struct LoopTest *test = context;
+    int grains[] = {1, 13, 1000};
+    for (int g = 0; g < 3; g++) {
+        parallelFor(test->offset, test->offset + RANGE_SIZE, grains[g], countRange, &test->offset);
+        // parallelFor() is a collective, so every member should see the whole range done as soon as it returns
+        for (int i = 0; i < RANGE_SIZE; i++) {
+            if (__atomic_load_n(&runCounts[i], __ATOMIC_RELAXED) != 1) {
+                __atomic_add_fetch(&test->early, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+        teamBarrier();
+        // rank 0 checks and clears the counts between loops, while the rest wait
+        if (rank == 0) checkRunCounts("parallelFor inside of a region", RANGE_SIZE);
+        teamBarrier();
+    }
+}
+
+static void testParallelFor(void) {
+    int grains[] = {1, 7, 64, RANGE_SIZE};
+    int offset = 17;
+    for (int repeat = 0; repeat < REPEATS; repeat++) {
+        int grain = grains[repeat % 4];
+        parallelFor(offset, offset + RANGE_SIZE, grain, countRange, &offset);
+        checkRunCounts("parallelFor", RANGE_SIZE);
+    }
+
+    // ranges too short to give every member something to do
+    for (int n = 0; n < 2 * teamSize() + 2; n++) {
+        parallelFor(offset, offset + n, 1, countRange, &offset);
+        checkRunCounts("parallelFor over a short range", n);
+    }
+
+    struct LoopTest test = {offset, 0};
+    for (int repeat = 0; repeat < REPEATS / 10; repeat++) runTeamRegion(loopRegion, &test);
+    if (test.early) fail("parallelFor inside of a region", teamSize(), "members returned early:", test.early);
+}
+
+#pragma mark - Main
+
+int main(int argc, const char * argv[]) {
+    int defaultSizes[] = {1, 2, 3, 4, 8};
+    int numSizes = (argc > 1) ? argc - 1 : 5;
+
+    int leaves = 1 << TASK_TREE_DEPTH;
+    int mostIndices = RANGE_SIZE;
+    for (int s = 0; s < numSizes; s++) {
+        int size = (argc > 1) ? atoi(argv[s + 1]) : defaultSizes[s];
+        if (size < 1 || size > 64) {
+            printf("Error: team sizes have to be from 1 to 64, not %s\n", argv[s + 1]);
+            return 2;
+        }
+        int taskIndices = size * (leaves > FLAT_TASKS ? leaves : FLAT_TASKS);
+        if (taskIndices > mostIndices) mostIndices = taskIndices;
+    }
+    runCounts = calloc(mostIndices, sizeof(int));
+
+    for (int s = 0; s < numSizes; s++) {
+        int size = (argc > 1) ? atoi(argv[s + 1]) : defaultSizes[s];
+        int failuresBefore = failures;
+        initTeam(size);
+        testTeamBlock();
+        testRegions();
+        testTasks();
+        testParallelFor();
+        freeTeam();
+        printf("%s with %i threads\n", (failures == failuresBefore) ? "ok" : "FAILED", size);
+    }
+
+    free(runCounts);
+    if (failures) {
+        printf("%i failures\n", failures);
+        return 1;
+    }
+    printf("No errors\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+# Builds and runs the tests. Run from NBodySim, like compile.sh. Exits with an error if any of them fail
+
+args="-lm -std=gnu11 -lpthread -O2 -Wall -Wno-unknown-pragmas"
+failed=0
+
+mkdir -p ./data
+
+echo "Team stress test"
+gcc ./teamTest.c ./team.c -o ./data/teamTest $args || exit 1
+./data/teamTest 1 2 3 4 8 16 || failed=1
+
+echo "Number formatting against printf"
+gcc ./numberFormatTest.c ./numberFormat.c -o ./data/numberFormatTest $args || exit 1
+./data/numberFormatTest || failed=1
+
+if [ $failed -ne 0 ]; then
+	printf "Tests failed\n"
+	exit 1
+fi
+printf "All tests passed\n"